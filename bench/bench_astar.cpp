@@ -0,0 +1,333 @@
+// bench_astar：地图预处理和搜索的基准测试，每条结果输出一行JSON，便于逐个提交比较
+//
+// 用法：bench_astar [--map a.map --scen a.scen] [--sizes 256,512,1024] [--threads 1,2,4]
+//                   [--queries 200] [--repeat 3] [--radius 2] [--out result.jsonl] [--check] [--tolerance 1e-3]
+// 不指定--map时使用合成迷宫（每个size一张），指定时只测MovingAI地图，查询来自--scen（没有则随机生成）
+// .scen带有参考最优长度时，额外输出各搜索配置相对它的偏差；--check时有查询超出容差则返回1
+#include "yAstar.hpp"
+#include "movingai.hpp"
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+#include<cstdio>
+#include<cstdlib>
+#include<fstream>
+#include<iostream>
+#include<numeric>
+#include<sstream>
+#include<string>
+#include<thread>
+#include<vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point t0){
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+// 按比例取分位数，samples会被排序
+static double percentile(std::vector<double>& samples, double p){
+    if(samples.empty()) return 0.;
+    std::sort(samples.begin(), samples.end());
+    size_t k = std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()));
+    return samples[k];
+}
+
+static std::vector<int> parseList(const std::string& text){
+    std::vector<int> values;
+    std::stringstream ss(text);
+    std::string item;
+    while(std::getline(ss, item, ',')){
+        if(!item.empty()) values.push_back(std::atoi(item.c_str()));
+    }
+    return values;
+}
+
+// 一条JSON结果，字段按添加顺序输出
+class Record{
+public:
+    explicit Record(const std::string& bench, const GridMap& map){
+        add("bench", bench);
+        add("map", map.name);
+        add("width", map.width);
+        add("height", map.height);
+    }
+    Record& add(const std::string& key, const std::string& value){
+        fields.push_back("\"" + key + "\":\"" + value + "\"");
+        return *this;
+    }
+    Record& add(const std::string& key, double value){
+        char text[64];
+        std::snprintf(text, sizeof(text), "%.6g", value);
+        fields.push_back("\"" + key + "\":" + text);
+        return *this;
+    }
+    Record& add(const std::string& key, int value){
+        return add(key, static_cast<double>(value));
+    }
+    Record& add(const std::string& key, size_t value){
+        return add(key, static_cast<double>(value));
+    }
+    void write(std::ostream& out) const {
+        out << "{";
+        for(size_t a=0;a<fields.size();a++){
+            out << (a ? "," : "") << fields[a];
+        }
+        out << "}" << std::endl;
+    }
+private:
+    std::vector<std::string> fields;
+};
+
+struct Options{
+    std::string mapPath, scenPath, outPath;
+    std::vector<int> sizes = {256, 512, 1024};
+    std::vector<int> threads;
+    int queries = 200;
+    int repeat = 3;
+    float radius = 2.f;// 代价地图膨胀半径（像素，mapping为1）
+    bool check = false;// 与参考最优长度比较失败时返回非0
+    double tolerance = 1e-3;// 允许的相对偏差（斜行代价1.414与sqrt(2)的差别约1.5e-4）
+};
+
+// 三种代价地图生成方式，各跑repeat次取中位数
+static void benchCostMap(AStar& astar, const GridMap& map, const Options& opt, std::ostream& out){
+    struct Variant{
+        const char* name;
+        void (AStar::*init)(float, float, std::function<float(float)>);
+    };
+    const Variant variants[] = {
+        {"initCostMap", &AStar::initCostMap},
+        {"initCostMapFast", &AStar::initCostMapFast},
+        {"initCostMapEDT", &AStar::initCostMapEDT},
+    };
+    for(const auto& v : variants){
+        std::vector<double> ms;
+        for(int r=0;r<opt.repeat;r++){
+            auto t0 = Clock::now();
+            (astar.*v.init)(1.f, opt.radius, [](float x){ return 1 / x; });
+            ms.push_back(secondsSince(t0) * 1e3);
+        }
+        double best = *std::min_element(ms.begin(), ms.end());
+        Record("costmap", map).add("variant", v.name).add("radius", opt.radius).add("repeat", opt.repeat)
+            .add("min_ms", best).add("p50_ms", percentile(ms, 0.5)).write(out);
+    }
+}
+
+// 单线程逐条查询，统计延迟分位数和扩展速度，返回找到的路径供后处理测试使用
+static std::vector<std::vector<std::pair<float,float>>> benchSearch(AStar& astar, const GridMap& map, const std::vector<Scenario>& scenarios, std::ostream& out){
+    std::vector<std::vector<std::pair<float,float>>> paths;
+    std::vector<double> us;
+    size_t expanded = 0, found = 0;
+    double total = 0.;
+    astar.prepare();
+    for(const auto& s : scenarios){
+        AStar::SearchStats stats;
+        auto t0 = Clock::now();
+        auto path = astar.search({static_cast<float>(s.sx), static_cast<float>(s.sy)}, {static_cast<float>(s.gx), static_cast<float>(s.gy)}, &stats);
+        double t = secondsSince(t0);
+        total += t;
+        us.push_back(t * 1e6);
+        expanded += stats.expanded;
+        if(!path.empty()){
+            found++;
+            paths.push_back(std::move(path));
+        }
+    }
+    double mean = us.empty() ? 0. : total * 1e6 / us.size();
+    Record("search", map).add("threads", 1).add("queries", scenarios.size()).add("found", found)
+        .add("p50_us", percentile(us, 0.5)).add("p99_us", percentile(us, 0.99)).add("mean_us", mean)
+        .add("expanded", expanded).add("expansions_per_s", total > 0. ? expanded / total : 0.).write(out);
+    return paths;
+}
+
+// 并行批量查询，按线程数测吞吐
+static void benchBatch(AStar& astar, const GridMap& map, const std::vector<Scenario>& scenarios, const Options& opt, std::ostream& out){
+    std::vector<std::pair<std::pair<float,float>, std::pair<float,float>>> queries;
+    for(const auto& s : scenarios){
+        queries.push_back({{static_cast<float>(s.sx), static_cast<float>(s.sy)}, {static_cast<float>(s.gx), static_cast<float>(s.gy)}});
+    }
+    for(int threads : opt.threads){
+        std::vector<double> ms;
+        size_t expanded = 0;
+        for(int r=0;r<opt.repeat;r++){
+            std::vector<AStar::SearchStats> stats;
+            auto t0 = Clock::now();
+            astar.searchBatch(queries, threads, &stats);
+            ms.push_back(secondsSince(t0) * 1e3);
+            expanded = 0;
+            for(const auto& st : stats) expanded += st.expanded;
+        }
+        double p50 = percentile(ms, 0.5);
+        Record("searchBatch", map).add("threads", threads).add("queries", queries.size()).add("repeat", opt.repeat)
+            .add("p50_ms", p50).add("queries_per_s", p50 > 0. ? queries.size() / (p50 * 1e-3) : 0.)
+            .add("expansions_per_s", p50 > 0. ? expanded / (p50 * 1e-3) : 0.).write(out);
+    }
+}
+
+// 路径后处理：压缩和稠密化
+static void benchPostprocess(AStar& astar, const GridMap& map, std::vector<std::vector<std::pair<float,float>>>& paths, std::ostream& out){
+    std::vector<double> simplifyUs, densifyUs;
+    size_t pointsIn = 0, pointsSimplified = 0;
+    for(auto& path : paths){
+        if(path.size() < 2) continue;
+        auto t0 = Clock::now();
+        auto simple = astar.simplifyPath(path, 0.5f);
+        simplifyUs.push_back(secondsSince(t0) * 1e6);
+        t0 = Clock::now();
+        auto dense = astar.densifyPath(simple, 1.f);
+        densifyUs.push_back(secondsSince(t0) * 1e6);
+        pointsIn += path.size();
+        pointsSimplified += simple.size();
+    }
+    Record("simplifyPath", map).add("paths", simplifyUs.size()).add("points_in", pointsIn).add("points_out", pointsSimplified)
+        .add("p50_us", percentile(simplifyUs, 0.5)).add("p99_us", percentile(simplifyUs, 0.99)).write(out);
+    Record("densifyPath", map).add("paths", densifyUs.size())
+        .add("p50_us", percentile(densifyUs, 0.5)).add("p99_us", percentile(densifyUs, 0.99)).write(out);
+}
+
+// 路径长度，直行1、斜行sqrt(2)。跳点搜索的路径只有跳点，相邻两点之间是直线或斜线，所以按欧氏距离累加
+static double pathLength(const std::vector<std::pair<float,float>>& path){
+    double length = 0.;
+    for(size_t a=1;a<path.size();a++){
+        length += std::hypot(path[a].first - path[a-1].first, path[a].second - path[a-1].second);
+    }
+    return length;
+}
+
+// 与.scen的参考最优长度比较：代价地图换成均匀代价（障碍物不可通行），逐个搜索配置统计长度偏差。
+// 这里的8邻居允许从两个障碍物之间斜穿过去（MovingAI不允许），所以路径可能比参考值短，只有变长才算失败
+// @return 是否所有查询都找到了路径且没有超出容差
+static bool benchOptimality(AStar& astar, const GridMap& map, const std::vector<Scenario>& scenarios, const Options& opt, std::ostream& out){
+    if(std::none_of(scenarios.begin(), scenarios.end(), [](const Scenario& s){ return s.optimal > 0.; })){
+        return true;
+    }
+    std::vector<u_char> unit(map.cells.size());
+    std::transform(map.cells.begin(), map.cells.end(), unit.begin(), [](u_char c) -> u_char { return c == 0 ? 255 : 1; });
+    astar.setCostMap(map.width, map.height, unit.data(), 1.f);
+    struct Config{
+        const char* name;
+        AStar::QueuePolicy queue;
+        bool jumpPointSearch;
+        double slack;// 额外允许的绝对误差
+    };
+    const Config configs[] = {
+        {"heap", AStar::QueuePolicy::BinaryHeap, false, 0.},
+        {"bucket", AStar::QueuePolicy::Bucket, false, 1.},// 误差界：最优代价 + 桶宽
+        {"jps", AStar::QueuePolicy::BinaryHeap, true, 0.},
+    };
+    bool ok = true;
+    for(const auto& c : configs){
+        astar.setQueuePolicy(c.queue);
+        astar.setJumpPointSearch(c.jumpPointSearch);
+        astar.prepare();
+        size_t compared = 0, measured = 0, shorter = 0, failed = 0;
+        double maxDeviation = 0., sumDeviation = 0.;
+        for(const auto& s : scenarios){
+            if(s.optimal <= 0.) continue;
+            compared++;
+            auto path = astar.search({static_cast<float>(s.sx), static_cast<float>(s.sy)}, {static_cast<float>(s.gx), static_cast<float>(s.gy)});
+            if(path.empty()){
+                failed++;
+                continue;
+            }
+            double length = pathLength(path);
+            double deviation = length / s.optimal - 1.;
+            maxDeviation = measured == 0 ? deviation : std::max(maxDeviation, deviation);
+            sumDeviation += deviation;
+            measured++;
+            if(deviation < -opt.tolerance) shorter++;
+            if(length > s.optimal * (1. + opt.tolerance) + c.slack) failed++;
+        }
+        Record("optimality", map).add("config", c.name).add("compared", compared).add("shorter", shorter).add("failed", failed)
+            .add("max_deviation", maxDeviation).add("mean_deviation", measured ? sumDeviation / measured : 0.).write(out);
+        ok = ok && failed == 0;
+    }
+    astar.setQueuePolicy(AStar::QueuePolicy::BinaryHeap);
+    astar.setJumpPointSearch(false);
+    return ok;
+}
+
+static bool benchMap(const GridMap& map, std::vector<Scenario> scenarios, const Options& opt, std::ostream& out){
+    AStar astar(map.width, map.height, const_cast<u_char*>(map.cells.data()));
+    astar.setTraditional(true);
+    astar.setNeighourCount(8);
+    benchCostMap(astar, map, opt, out);
+    if(scenarios.empty()){
+        scenarios = randomScenarios(map, opt.queries, 1);
+    }else if(static_cast<int>(scenarios.size()) > opt.queries){
+        scenarios.resize(opt.queries);
+    }
+    auto paths = benchSearch(astar, map, scenarios, out);
+    benchBatch(astar, map, scenarios, opt, out);
+    benchPostprocess(astar, map, paths, out);
+    return benchOptimality(astar, map, scenarios, opt, out);
+}
+
+int main(int argc, char** argv){
+    Options opt;
+    for(int a=1;a<argc;a++){
+        std::string arg = argv[a];
+        auto value = [&]() -> std::string {
+            if(a + 1 >= argc){
+                std::cerr << "missing value for " << arg << std::endl;
+                std::exit(2);
+            }
+            return argv[++a];
+        };
+        if(arg == "--map") opt.mapPath = value();
+        else if(arg == "--scen") opt.scenPath = value();
+        else if(arg == "--out") opt.outPath = value();
+        else if(arg == "--sizes") opt.sizes = parseList(value());
+        else if(arg == "--threads") opt.threads = parseList(value());
+        else if(arg == "--queries") opt.queries = std::max(1, std::atoi(value().c_str()));
+        else if(arg == "--repeat") opt.repeat = std::max(1, std::atoi(value().c_str()));
+        else if(arg == "--radius") opt.radius = std::atof(value().c_str());
+        else if(arg == "--check") opt.check = true;
+        else if(arg == "--tolerance") opt.tolerance = std::atof(value().c_str());
+        else{
+            std::cerr << "usage: bench_astar [--map a.map --scen a.scen] [--sizes 256,512] [--threads 1,2,4]"
+                         " [--queries N] [--repeat N] [--radius R] [--out file] [--check] [--tolerance T]" << std::endl;
+            return arg == "--help" ? 0 : 2;
+        }
+    }
+    if(opt.threads.empty()){
+        int hw = std::max(1u, std::thread::hardware_concurrency());
+        for(int t=1;t<hw;t*=2) opt.threads.push_back(t);
+        opt.threads.push_back(hw);
+    }
+
+    // 查询失败时search会往stdout打印，结果默认也写stdout，需要干净的输出时用--out
+    std::ofstream file;
+    if(!opt.outPath.empty()){
+        file.open(opt.outPath);
+        if(!file){
+            std::cerr << "cannot open " << opt.outPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = opt.outPath.empty() ? std::cout : file;
+
+    if(!opt.mapPath.empty()){
+        GridMap map;
+        if(!loadMovingAIMap(opt.mapPath, map)){
+            std::cerr << "cannot load map " << opt.mapPath << std::endl;
+            return 1;
+        }
+        std::vector<Scenario> scenarios;
+        if(!opt.scenPath.empty() && !loadMovingAIScenarios(opt.scenPath, scenarios)){
+            std::cerr << "cannot load scenarios " << opt.scenPath << std::endl;
+            return 1;
+        }
+        bool optimal = benchMap(map, scenarios, opt, out);
+        if(opt.check && !optimal){
+            std::cerr << "paths deviate from the scenario optimal lengths" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    for(int size : opt.sizes){
+        benchMap(makeMaze(size, 1), {}, opt, out);
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "movingai.hpp"
+#include<fstream>
+#include<sstream>
+#include<random>
+#include<algorithm>
+
+bool loadMovingAIMap(const std::string& path, GridMap& map){
+    std::ifstream in(path);
+    if(!in) return false;
+    std::string key;
+    int width = -1, height = -1;
+    // 文件头：type octile / height H / width W / map
+    while(in >> key && key != "map"){
+        if(key == "height") in >> height;
+        else if(key == "width") in >> width;
+        else if(key == "type") in >> key;
+    }
+    if(key != "map" || width <= 0 || height <= 0) return false;
+    map.width = width;
+    map.height = height;
+    map.cells.assign(static_cast<size_t>(width)*height, 0);
+    std::string row;
+    for(int y=0;y<height;y++){
+        if(!(in >> row) || static_cast<int>(row.size()) < width) return false;
+        for(int x=0;x<width;x++){
+            char c = row[x];
+            map.cells[static_cast<size_t>(y)*width+x] = (c == '.' || c == 'G' || c == 'S') ? 255 : 0;
+        }
+    }
+    map.name = path.substr(path.find_last_of('/') + 1);
+    return true;
+}
+
+bool loadMovingAIScenarios(const std::string& path, std::vector<Scenario>& scenarios){
+    std::ifstream in(path);
+    if(!in) return false;
+    std::string line;
+    scenarios.clear();
+    while(std::getline(in, line)){
+        if(line.empty() || line.rfind("version", 0) == 0) continue;
+        std::istringstream fields(line);
+        Scenario s;
+        std::string mapName;
+        int width, height;
+        if(fields >> s.bucket >> mapName >> width >> height >> s.sx >> s.sy >> s.gx >> s.gy >> s.optimal){
+            scenarios.push_back(s);
+        }
+    }
+    return !scenarios.empty();
+}
+
+GridMap makeMaze(int size, unsigned seed){
+    GridMap map;
+    map.name = "maze" + std::to_string(size);
+    map.width = map.height = size;
+    map.cells.assign(static_cast<size_t>(size)*size, 0);
+    // 奇数坐标为房间，房间之间打通一格墙
+    int rooms = (size - 1) / 2;
+    if(rooms <= 0) return map;
+    std::mt19937 rng(seed);
+    std::vector<char> visited(static_cast<size_t>(rooms)*rooms, 0);
+    std::vector<int> stack = {0};
+    visited[0] = 1;
+    map.cells[static_cast<size_t>(1)*size+1] = 255;
+    const int dirs[4][2] = {{1,0},{-1,0},{0,1},{0,-1}};
+    while(!stack.empty()){
+        int cur = stack.back();
+        int cx = cur % rooms, cy = cur / rooms;
+        int options[4], count = 0;
+        for(int d=0;d<4;d++){
+            int nx = cx + dirs[d][0], ny = cy + dirs[d][1];
+            if(nx>=0 && nx<rooms && ny>=0 && ny<rooms && !visited[ny*rooms+nx]) options[count++] = d;
+        }
+        if(count == 0){
+            stack.pop_back();
+            continue;
+        }
+        int d = options[rng() % count];
+        int nx = cx + dirs[d][0], ny = cy + dirs[d][1];
+        visited[ny*rooms+nx] = 1;
+        map.cells[static_cast<size_t>(2*cy+1+dirs[d][1])*size + 2*cx+1+dirs[d][0]] = 255;
+        map.cells[static_cast<size_t>(2*ny+1)*size + 2*nx+1] = 255;
+        stack.push_back(ny*rooms+nx);
+    }
+    return map;
+}
+
+std::vector<Scenario> randomScenarios(const GridMap& map, int count, unsigned seed){
+    std::vector<int> free;
+    for(size_t a=0;a<map.cells.size();a++){
+        if(map.cells[a] != 0) free.push_back(static_cast<int>(a));
+    }
+    std::vector<Scenario> scenarios;
+    if(free.size() < 2) return scenarios;
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> pick(0, free.size()-1);
+    for(int q=0;q<count;q++){
+        int s = free[pick(rng)], g = free[pick(rng)];
+        Scenario sc;
+        sc.sx = s % map.width; sc.sy = s / map.width;
+        sc.gx = g % map.width; sc.gy = g / map.width;
+        scenarios.push_back(sc);
+    }
+    return scenarios;
+}
@@ -0,0 +1,36 @@
+#ifndef YASTAR_BENCH_MOVINGAI_HPP
+#define YASTAR_BENCH_MOVINGAI_HPP
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// 栅格地图，语义与AStar::setMap相同：0为障碍物，255为可通行
+struct GridMap{
+    std::string name;
+    int width = 0, height = 0;
+    std::vector<u_char> cells;
+};
+
+// 一条查询，坐标为像素
+struct Scenario{
+    int bucket = 0;
+    int sx = 0, sy = 0, gx = 0, gy = 0;
+    double optimal = 0.;// 参考最优长度（直行1，斜行sqrt(2)，不允许斜穿障碍物的角），<=0表示未知
+};
+
+// @brief 读取MovingAI格式的.map文件，'.' 'G' 'S'为可通行，其余（'@' 'O' 'T' 'W'）为障碍物
+// @return 是否成功
+bool loadMovingAIMap(const std::string& path, GridMap& map);
+
+// @brief 读取MovingAI格式的.scen文件（version 1）
+// @return 是否成功
+bool loadMovingAIScenarios(const std::string& path, std::vector<Scenario>& scenarios);
+
+// @brief 生成size*size的完美迷宫（随机深度优先），走廊宽1像素，任意两个可通行格子之间都连通
+GridMap makeMaze(int size, unsigned seed);
+
+// @brief 在可通行格子中随机选取起点终点对
+std::vector<Scenario> randomScenarios(const GridMap& map, int count, unsigned seed);
+
+#endif // YASTAR_BENCH_MOVINGAI_HPP
@@ -0,0 +1,58 @@
+// 桶队列的误差界：传统8邻居A*、启发函数可采纳时，桶队列返回的路径代价不超过 最优代价 + 桶宽
+// 在固定种子的随机地图上与二叉堆（精确）的结果逐条比较
+#include "yAstar.hpp"
+#include<cstdio>
+#include<random>
+#include<vector>
+
+// 按搜索的代价模型计算路径代价：走进格子的代价，斜行乘1.414
+static float pathCost(AStar& astar, const std::vector<std::pair<float,float>>& path){
+    float cost = 0.f;
+    for(size_t a=1;a<path.size();a++){
+        int x = path[a].first, y = path[a].second;
+        bool diagonal = x != static_cast<int>(path[a-1].first) && y != static_cast<int>(path[a-1].second);
+        cost += astar.cellCost(x, y) * (diagonal ? 1.414f : 1.f);
+    }
+    return cost;
+}
+
+int main(){
+    const int width = 160, height = 150, queries = 2000;
+    const float bucketWidth = 1.f;
+    std::mt19937 rng(20240611);
+    std::vector<u_char> map(width*height), cost(width*height);
+    for(int a=0;a<width*height;a++){
+        map[a] = rng()%100 < 20 ? 0 : 255;
+        cost[a] = map[a] == 0 ? 255 : 1;// 均匀代价，f值大量相同，最容易暴露桶的问题
+    }
+    AStar exact(width, height, map.data()), bucket(width, height, map.data());
+    for(AStar* astar : {&exact, &bucket}){
+        astar->setTraditional(true);
+        astar->setNeighourCount(8);
+        astar->setCostMap(width, height, cost.data(), 1.f);
+    }
+    bucket.setQueuePolicy(AStar::QueuePolicy::Bucket, bucketWidth);
+
+    std::uniform_int_distribution<int> px(0, width-1), py(0, height-1);
+    int compared = 0, violations = 0;
+    for(int q=0;q<queries;q++){
+        int sx = px(rng), sy = py(rng), gx = px(rng), gy = py(rng);
+        if(map[sy*width+sx] == 0 || map[gy*width+gx] == 0) continue;
+        auto optimal = exact.search({static_cast<float>(sx), static_cast<float>(sy)}, {static_cast<float>(gx), static_cast<float>(gy)});
+        auto approx = bucket.search({static_cast<float>(sx), static_cast<float>(sy)}, {static_cast<float>(gx), static_cast<float>(gy)});
+        if(optimal.empty() != approx.empty()){
+            std::printf("query %d: reachability differs\n", q);
+            violations++;
+            continue;
+        }
+        if(optimal.empty()) continue;
+        compared++;
+        float c0 = pathCost(exact, optimal), c1 = pathCost(bucket, approx);
+        if(c1 > c0 + bucketWidth + 1e-3f * c0){
+            std::printf("query %d: (%d,%d)->(%d,%d) bucket %.3f > optimal %.3f + %.1f\n", q, sx, sy, gx, gy, c1, c0, bucketWidth);
+            violations++;
+        }
+    }
+    std::printf("%d queries compared, %d violations\n", compared, violations);
+    return violations == 0 && compared > 0 ? 0 : 1;
+}
@@ -5,6 +5,16 @@
 #include<thread>
 #include<future>
 #include<ranges>
+#include<type_traits>
+#include<climits>
+#include<atomic>
+#include<cstring>
+#include<chrono>
+
+// 邻居方向(dy, dx)，前4个为直行，后4个为斜行
+static constexpr int neighour[8][2] = {{-1,0},{1,0},{0,-1},{0,1},{-1,-1},{-1,1},{1,-1},{1,1}};
+// 由(dy+1, dx+1)查邻居方向编号
+static constexpr int neighourOf[3][3] = {{4,0,5},{2,-1,3},{6,1,7}};
 
 inline float quickSqrt(float x){
     // // c++版本
@@ -26,6 +36,111 @@ inline float quickSqrt(float x){
     return sqrtf(x);
 }
 
+// 启发函数策略，参数为到终点的像素差。distance在搜索循环中使用（可以是近似值），exact只用于起点
+struct EuclideanHeuristic{
+    static inline float distance(int dx, int dy){ return quickSqrt(dx * dx + dy * dy); }
+    static inline float exact(int dx, int dy){ return std::hypotf(dx, dy); }
+    // 到多个目标中最近一个的距离，先比较平方再开一次方
+    static inline float nearest(int x, int y, const int* gx, const int* gy, size_t n){
+        int best = INT_MAX;
+        for(size_t k=0;k<n;k++){
+            int dx = x - gx[k], dy = y - gy[k];
+            best = std::min(best, dx * dx + dy * dy);
+        }
+        return quickSqrt(best);
+    }
+};
+// 代价读取策略，按格子索引返回搜索使用的代价
+struct FloatCost{
+    const float* data;
+    inline float operator()(size_t index) const { return data[index]; }
+};
+struct Quant8Cost{
+    const uint8_t* data;
+    float step;
+    inline float operator()(size_t index) const { return data[index] * step; }
+};
+struct BFloat16Cost{
+    const uint16_t* data;
+    inline float operator()(size_t index) const {
+        uint32_t bits = static_cast<uint32_t>(data[index]) << 16;
+        float c;
+        std::memcpy(&c, &bits, sizeof(c));
+        return c;
+    }
+};
+
+// 从t0到现在的秒数
+static inline double secondsSince(std::chrono::steady_clock::time_point t0){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// 搜索主循环的计数器，计数只是局部变量自增，finish时才写入SearchStats；没有统计输出时不计时
+// YASTAR_STATS为0时所有操作都是空函数
+struct SearchCounter{
+#if YASTAR_STATS
+    AStar::SearchStats* stats;
+    std::chrono::steady_clock::time_point t0;
+    size_t expanded = 0, pushes = 0, peakOpen = 0;
+    explicit SearchCounter(AStar::SearchStats* _stats): stats(_stats) {
+        if(stats) t0 = std::chrono::steady_clock::now();
+    }
+    inline void expand(){ expanded++; }
+    inline void push(){ pushes++; }
+    inline void open(size_t size){ peakOpen = std::max(peakOpen, size); }
+    // 主循环结束（找到终点），之后的时间算作回溯
+    inline void searchDone(){
+        if(stats){
+            stats->searchSeconds = secondsSince(t0);
+            t0 = std::chrono::steady_clock::now();
+        }
+    }
+    void finish(bool found, size_t stalePops, size_t touched){
+        if(!stats) return;
+        (found ? stats->reconstructSeconds : stats->searchSeconds) = secondsSince(t0);
+        stats->expanded = expanded;
+        stats->pushes = pushes;
+        stats->stalePops = stalePops;
+        stats->peakOpen = peakOpen;
+        stats->touched = touched;
+        stats->found = found;
+    }
+#else
+    explicit SearchCounter(AStar::SearchStats*) {}
+    inline void expand(){}
+    inline void push(){}
+    inline void open(size_t){}
+    inline void searchDone(){}
+    inline void finish(bool, size_t, size_t){}
+#endif
+};
+
+// float转BFloat16，向上取整（正数），无穷保持为无穷
+static inline uint16_t toBFloat16Ceil(float c){
+    uint32_t bits;
+    std::memcpy(&bits, &c, sizeof(bits));
+    if((bits & 0xFFFFu) && c < std::numeric_limits<float>::infinity() && c > 0.f){
+        bits += 0x10000u;
+    }
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+struct OctileHeuristic{
+    static inline float distance(int dx, int dy){
+        dx = std::abs(dx);
+        dy = std::abs(dy);
+        return std::max(dx, dy) + 0.414f * std::min(dx, dy);
+    }
+    static inline float exact(int dx, int dy){ return distance(dx, dy); }
+    static inline float nearest(int x, int y, const int* gx, const int* gy, size_t n){
+        float best = std::numeric_limits<float>::infinity();
+        for(size_t k=0;k<n;k++){
+            best = std::min(best, distance(x - gx[k], y - gy[k]));
+        }
+        return best;
+    }
+};
+
 inline float distanceFromLine(float l0x,float l0y,float l1x,float l1y,float x,float y){
     float dx = l1x-l0x, dy = l1y-l0y;              // 线段的向量
     float dx2 = x - l0x, dy2 = y - l0y;            // 线段起点到点的向量
@@ -109,47 +224,259 @@ float AStar::getLength(std::vector<std::pair<float, float>>& _path) const {
 
 AStar::AStar(int width, int height, u_char* mapData){
     setMap(width, height, mapData);
-    setMapping(1.0f);
-    setStride(1.0f);
-    setNeighourCount(8);
-    reseted = false;
-    costWeight = 1.0f;
+    mapping = 1.0f;
+    stride = 1.0f;
+    neighourCount = 8;
     speed=0.f;
+    buildMotionTable();
+    costWeight = 1.0f;
     traditional = false;
 }
 
 void AStar::setMapping(float _scaleMeterPerPixel){
     mapping = _scaleMeterPerPixel;
+    buildMotionTable();
 }
 
 void AStar::setMap(int width, int height, u_char *mapData){
     originMap = YTensor<u_char,2>(height, width);
-    nodeMap= YTensor<Node,2>(height, width);
-    reset();
-    reseted = true;
     std::copy(mapData, mapData+width*height, originMap.data);
+    onMapChanged();
+}
+
+void AStar::setMapView(int width, int height, u_char *mapData){
+    YTensor<u_char,2> view = YTensor<u_char,2>::view(mapData, {height, width});
+    originMap.swap(view);
+    onMapChanged();
+}
+
+void AStar::onMapChanged(){
+    int width = originMap.shape(1), height = originMap.shape(0);
+    context.resize(width, height);
+    jumpMapDirty = true;
+    int words = (width+63)/64;
+    occupancyMap = YTensor<uint64_t,2>(height, words);
+    blockedMap = YTensor<uint64_t,2>(height, words);
+    blockedMap.fill(0);// 在设置代价地图之前都视为可通行
+    packOccupancy(0, height);
+    componentsDirty = true;
+    overlaidCost.clear();
+    clearFieldCache();
 }
 
 void AStar::setStride(float _strideMeter){
     stride = _strideMeter;
+    buildMotionTable();
 }
 
 void AStar::setNeighourCount(int _neighourCount){
     neighourCount = _neighourCount;
+    buildMotionTable();
 }
 
 void AStar::setSpeed(float _speed){
     speed = _speed;
+    buildMotionTable();
 }
 
 void AStar::setTraditional(bool _traditional){
     traditional = _traditional;
 }
 
+void AStar::setQueuePolicy(QueuePolicy _policy, float _bucketWidth){
+    queuePolicy = _policy;
+    bucketWidth = _bucketWidth;
+}
+
+void AStar::setHeuristic(HeuristicPolicy _heuristic){
+    heuristic = _heuristic;
+}
+
+void AStar::setJumpPointSearch(bool _jumpPointSearch){
+    jumpPointSearch = _jumpPointSearch;
+}
+
+void AStar::buildMotionTable(){
+    float mappedStride = stride/mapping;// 映射后的步长
+    float mappedSpeed = std::max(speed/mapping, 0.f);// 映射后的最大速度
+    int whole = static_cast<int>(mappedSpeed);
+    motionHalf = whole + (mappedSpeed > whole || whole == 0 ? 1 : 0);// S不是整数时两端多出±S两种取值，S为0时也一样（-0与+0的速度方向不同）
+    int speedCount = 2*motionHalf+1;
+    motionSpeeds.resize(speedCount);
+    for(int k=0;k<speedCount;k++){
+        motionSpeeds[k] = static_cast<float>(k - motionHalf);
+    }
+    motionSpeeds.front() = -mappedSpeed;
+    motionSpeeds.back() = mappedSpeed;
+    std::vector<float> angles(neighourCount);
+    for(int i=0;i<neighourCount;i++){
+        angles[i] = i*2*M_PI/neighourCount;
+    }
+    motionOffsets.resize(static_cast<size_t>(speedCount)*speedCount*neighourCount);
+    for(int state=0;state<speedCount*speedCount;state++){
+        float angle0 = std::atan2(motionSpeeds[state/speedCount], motionSpeeds[state%speedCount]);// 速度方向角度
+        for(int i=0;i<neighourCount;i++){
+            float angle = angles[i] + angle0; // 邻居角度（已考虑方向）
+            float radius = mappedStride * quickSqrt(1 / (1 + std::tan(angle) * std::tan(angle)));
+            motionOffsets[state*neighourCount+i] = std::make_pair(radius * std::cos(angle), radius * std::sin(angle));// 距离代价理应相等
+        }
+    }
+}
+
+void AStar::onCostMapChanged(){
+    onCostMapChanged(0, 0, costMap.shape(1), costMap.shape(0));
+}
+
+void AStar::onCostMapChanged(int x0, int y0, int x1, int y1){
+    if(hardInflateRadius > 0){
+        if(inflateMode == InflateMode::None){
+            overlayHardInflation(x0, y0, x1, y1);
+        }else{
+            applyHardInflation(x0, y0, x1, y1);
+        }
+    }
+    packBlocked(y0, y1);
+    clearFieldCache();// 局部改变也可能影响任意终点的距离场
+    if(x0 == 0 && y0 == 0 && x1 == costMap.shape(1) && y1 == costMap.shape(0)){
+        buildComponents();
+    }else{
+        updateComponents(x0, y0, x1, y1);
+    }
+    if(costStorage != CostStorage::Float32){
+        packCompactCost(x0, y0, x1, y1);
+    }
+    jumpMapDirty = true;
+}
+
+void AStar::overlayHardInflation(int x0, int y0, int x1, int y1){
+    int width = costMap.shape(1);
+    // 先还原窗口内叠加过、现在不是障碍物的格子，得到没有硬膨胀的代价
+    std::vector<float> before(static_cast<size_t>(x1-x0)*(y1-y0));
+    for(int y=y0; y<y1; y++){
+        for(int x=x0; x<x1; x++){
+            size_t i = static_cast<size_t>(y)*width+x;
+            if(!overlaidCost.empty() && originMap.atData(i) != 0){
+                if(auto it = overlaidCost.find(i); it != overlaidCost.end()){
+                    costMap.atData(i) = it->second;
+                    overlaidCost.erase(it);
+                }
+            }
+            before[static_cast<size_t>(y-y0)*(x1-x0)+(x-x0)] = costMap.atData(i);
+        }
+    }
+    applyHardInflation(x0, y0, x1, y1);
+    // 被硬膨胀改为无穷的格子记下原代价，障碍物移除或半径改变时还原
+    for(int y=y0; y<y1; y++){
+        for(int x=x0; x<x1; x++){
+            size_t i = static_cast<size_t>(y)*width+x;
+            float old = before[static_cast<size_t>(y-y0)*(x1-x0)+(x-x0)];
+            if(old < std::numeric_limits<float>::infinity() && !(costMap.atData(i) < std::numeric_limits<float>::infinity())){
+                overlaidCost.emplace(i, old);
+            }
+        }
+    }
+}
+
+void AStar::setCostStorage(CostStorage _storage, float _quantum){
+    costStorage = _storage;
+    storageQuantum = _quantum;
+    if(costStorage != CostStorage::Float32 && costMap.data != nullptr){
+        packCompactCost(0, 0, costMap.shape(1), costMap.shape(0));
+    }
+}
+
+float AStar::cellCost(int x, int y) const {
+    size_t index = static_cast<size_t>(y)*costMap.shape(1)+x;
+    switch(costStorage){
+        case CostStorage::Quant8:
+            return costMap8.data[index] == 255 ? std::numeric_limits<float>::infinity() : Quant8Cost{costMap8.data, quant8Step}(index);
+        case CostStorage::BFloat16:
+            return BFloat16Cost{costMap16.data}(index);
+        default:
+            return costMap.data[index];
+    }
+}
+
+void AStar::packCompactCost(int x0, int y0, int x1, int y1){
+    int width = costMap.shape(1), height = costMap.shape(0);
+    bool full = x0 == 0 && y0 == 0 && x1 == width && y1 == height;
+    if(costStorage == CostStorage::Quant8){
+        if(costMap8.data == nullptr || costMap8.shape(0) != height || costMap8.shape(1) != width){
+            costMap8 = YTensor<uint8_t,2>(height, width);
+            full = true;
+        }
+        if(full){
+            // 整张重建时重新确定量化步长，局部更新沿用之前的步长（超出范围的代价截断到254）
+            if(storageQuantum > 0.f){
+                quant8Step = storageQuantum;
+            }else{
+                auto range = std::transform_reduce(std::execution::par_unseq, costMap.data, costMap.data+costMap.size(),
+                    std::make_pair(std::numeric_limits<float>::infinity(), 0.f),
+                    [](std::pair<float,float> a, std::pair<float,float> b){ return std::make_pair(std::min(a.first, b.first), std::max(a.second, b.second)); },
+                    [](float c){ return c < std::numeric_limits<float>::infinity() ? std::make_pair(c, c) : std::make_pair(std::numeric_limits<float>::infinity(), 0.f); });
+                float minCost = range.first, maxCost = range.second;
+                // 整数代价地图的0格存为0.1*权重，有这种格子时步长取0.1*权重才能精确表示；
+                // 放不下时取权重（只有0格向上取整为1*权重），仍然放不下或不是整数代价地图时按范围量化（有损）
+                if(costQuantum > 0.f && minCost < costQuantum && maxCost <= 254.f * 0.1f * costQuantum){
+                    quant8Step = 0.1f * costQuantum;
+                }else if(costQuantum > 0.f && maxCost <= 254.f * costQuantum){
+                    quant8Step = costQuantum;
+                }else{
+                    quant8Step = maxCost > 0.f ? maxCost / 254.f : 1.f;
+                }
+            }
+            x0 = 0; y0 = 0; x1 = width; y1 = height;
+        }
+        auto rows = std::views::iota(y0, y1);
+        std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y){
+            for(int x=x0; x<x1; x++){
+                size_t i = static_cast<size_t>(y)*width+x;
+                float c = costMap.data[i];
+                // 乘以(1-1e-6)吸收浮点舍入，步长整数倍的代价不会多进一格
+                costMap8.data[i] = c < std::numeric_limits<float>::infinity() ? static_cast<uint8_t>(std::min(254.f, std::ceil(c / quant8Step * (1.f - 1e-6f)))) : 255;
+            }
+        });
+    }else if(costStorage == CostStorage::BFloat16){
+        if(costMap16.data == nullptr || costMap16.shape(0) != height || costMap16.shape(1) != width){
+            costMap16 = YTensor<uint16_t,2>(height, width);
+            x0 = 0; y0 = 0; x1 = width; y1 = height;
+        }
+        auto rows = std::views::iota(y0, y1);
+        std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y){
+            for(int x=x0; x<x1; x++){
+                size_t i = static_cast<size_t>(y)*width+x;
+                costMap16.data[i] = toBFloat16Ceil(costMap.data[i]);
+            }
+        });
+    }
+}
+
+void AStar::setHardInflation(float _radiusMeter){
+    hardInflateRadius = std::max(0, static_cast<int>(_radiusMeter / mapping));
+    if(costMap.data != nullptr && costMap.shape(0) == originMap.shape(0) && costMap.shape(1) == originMap.shape(1)){
+        onCostMapChanged();
+    }
+}
+
 void AStar::setCostMap(int width, int height, float* _costmapData,float weight){
     costMap = YTensor<float,2>(height, width);
     // std::copy(_costmapData, _costmapData+width*height, costMap.data);
     std::transform(std::execution::par_unseq, _costmapData, _costmapData+width*height, costMap.data, [weight](auto& x){ return x*weight; });
+    costQuantum = 0.f;// 任意浮点代价
+    costWeight = weight;
+    inflateMode = InflateMode::None;
+    overlaidCost.clear();
+    onCostMapChanged();
+}
+
+void AStar::setCostMapView(int width, int height, float* _costmapData){
+    YTensor<float,2> view = YTensor<float,2>::view(_costmapData, {height, width});
+    costMap.swap(view);
+    costQuantum = 0.f;// 任意浮点代价
+    costWeight = 1.f;
+    inflateMode = InflateMode::None;
+    overlaidCost.clear();
+    onCostMapChanged();
 }
 
 void AStar::setCostMap(int width, int height, u_char *_costmapData, float weight){
@@ -164,13 +491,21 @@ void AStar::setCostMap(int width, int height, u_char *_costmapData, float weight
         }
         costMap.atData(a) = basic * weight;
     }
+    costQuantum = weight;// 整数代价乘权重
+    costWeight = weight;
+    inflateMode = InflateMode::None;
+    overlaidCost.clear();
+    onCostMapChanged();
 }
 
 YTensor<float,2> AStar::getCostMap(){
-    return costMap;
+    return YTensor<float,2>::view(costMap.data, costMap.shape());
 }
 
 YTensor<u_char,2> AStar::getCostMapImage(){
+    if(costStorage == CostStorage::Quant8 && costMap8.data != nullptr){
+        return YTensor<u_char,2>::view(costMap8.data, costMap8.shape());
+    }
     YTensor<u_char,2> costMapImage(costMap.shape());
     for(size_t a=0; a<costMapImage.size();a++){
         float scale = costMap.atData(a);
@@ -214,12 +549,13 @@ void AStar::initCostMap(float _costWeight, float _funcInflateRadius, std::functi
             cur++;
         }
     }
+    costQuantum = 0.f;
+    rememberSquareInflation(r, _costWeight, biasMask);
+    onCostMapChanged();
 }
 
 void AStar::initCostMapFast(float _costWeight, float _funcInflateRadius, std::function<float(float)> _decayFunction){
     int r = _funcInflateRadius / mapping; // 膨胀半径
-    YTensor<float, 2> temp(originMap.shape());
-    // 创建一个相当于迭代器的东西，遍历所有的，空白的点。
     std::vector<std::pair<std::pair<int,int>,std::pair<int,float>>> biasMask;// xy bias val
     for (int a = -r; a <= r; a++){
         for (int b = -r; b <= r; b++){
@@ -232,86 +568,522 @@ void AStar::initCostMapFast(float _costWeight, float _funcInflateRadius, std::fu
             }
         }
     }
+    // 排序后biasMask是按照权重从大到小的，每个像素第一个碰到的障碍物就是结果
+    rememberSquareInflation(r, _costWeight, biasMask);
+    costMap = YTensor<float, 2>(originMap.shape());
+    inflateSquare(0, 0, originMap.shape(1), originMap.shape(0));
+    costQuantum = 0.f;
+    onCostMapChanged();
+}
+
+void AStar::rememberSquareInflation(int r, float _costWeight, std::vector<std::pair<std::pair<int,int>,std::pair<int,float>>>& biasMask){
     std::sort(biasMask.begin(), biasMask.end(), [](auto& a, auto& b){
         return a.second.second>b.second.second;
     });
-    // 现在，biasMask是按照权重从大到小排序的。
-    auto indexView = std::views::iota(0, static_cast<int>(originMap.size()));
-    std::transform(std::execution::par_unseq, indexView.begin(), indexView.end(), temp.data, [&](int i){
-        if(originMap.atData(i) == 0)return std::numeric_limits<float>::infinity();
-        int x = i % originMap.shape(1);
-        int y = i / originMap.shape(1);
-        float mindist = std::numeric_limits<float>::infinity();
-        for(auto& mask0:biasMask){
-            int nx=mask0.first.first+x, ny=mask0.first.second+y;
-            if(nx<0 || nx>=originMap.shape(1) || ny<0 || ny>=originMap.shape(0))continue;
-            auto& target= originMap.atData(mask0.second.first+i);
-            if(target==0){
-                // 碰到了障碍物，直接结算！
-                return mask0.second.second;
+    inflateMask.swap(biasMask);
+    inflateTable.clear();
+    inflateRadius = r;
+    costWeight = _costWeight;
+    inflateMode = InflateMode::Square;
+    overlaidCost.clear();
+}
+
+void AStar::initCostMapEDT(float _costWeight, float _funcInflateRadius, std::function<float(float)> _decayFunction){
+    int r = _funcInflateRadius / mapping; // 膨胀半径
+    auto decayTable = buildDecayTable(r, _costWeight, _decayFunction);
+    // 借用的缓冲区（setCostMapView、快照）不能被覆盖，与initCostMap一样换成自己拥有的代价地图
+    if(costMap.data == nullptr || !costMap.parent || costMap.shape() != originMap.shape()){
+        costMap = YTensor<float, 2>(originMap.shape());
+    }
+    inflateEDT(0, 0, originMap.shape(1), originMap.shape(0), 0, 0, originMap.shape(1), originMap.shape(0), decayTable, _costWeight);
+    costQuantum = 0.f;
+    inflateTable.swap(decayTable);
+    inflateMask.clear();
+    inflateRadius = r;
+    costWeight = _costWeight;
+    inflateMode = InflateMode::Disk;
+    overlaidCost.clear();
+    onCostMapChanged();
+}
+
+AStar::Region AStar::updateRegion(int x, int y, int w, int h, u_char* patch){
+    int width = originMap.shape(1), height = originMap.shape(0);
+    std::vector<size_t> flipped;// 障碍物状态改变了的格子（只在没有膨胀信息时需要）
+    for(int row=0; row<h; row++){
+        int yy = y + row;
+        if(yy<0 || yy>=height) continue;
+        for(int col=0; col<w; col++){
+            int xx = x + col;
+            if(xx<0 || xx>=width) continue;
+            size_t i = static_cast<size_t>(yy)*width+xx;
+            if(inflateMode == InflateMode::None && (originMap.atData(i) == 0) != (patch[row*w+col] == 0)){
+                flipped.push_back(i);
+            }
+            originMap.atData(i) = patch[row*w+col];
+        }
+    }
+    packOccupancy(std::clamp(y, 0, height), std::clamp(y+h, 0, height));
+    if(costMap.data == nullptr){
+        return Region{std::clamp(x, 0, width), std::clamp(y, 0, height), 0, 0};
+    }
+    // 更新矩形外扩膨胀半径，就是代价可能改变的范围
+    int r = std::max(inflateMode == InflateMode::None ? 0 : inflateRadius, hardInflateRadius);
+    int x0 = std::max(0, x-r), y0 = std::max(0, y-r);
+    int x1 = std::min(width, x+w+r), y1 = std::min(height, y+h+r);
+    if(x0 >= x1 || y0 >= y1){
+        return Region{x0, y0, 0, 0};
+    }
+    if(inflateMode == InflateMode::Disk){
+        // 再外扩一个半径，窗口外的障碍物不会影响输出范围
+        inflateEDT(std::max(0, x0-r), std::max(0, y0-r), std::min(width, x1+r), std::min(height, y1+r), x0, y0, x1, y1, inflateTable, costWeight);
+    }else if(inflateMode == InflateMode::Square){
+        // 与initCostMapFast相同：按权重从大到小找第一个碰到的障碍物
+        inflateSquare(x0, y0, x1, y1);
+    }else{
+        // 没有膨胀信息，只处理障碍物状态改变了的格子：变为障碍物时记下原代价，恢复可通行时还原
+        for(size_t i : flipped){
+            float& cost = costMap.atData(i);
+            if(originMap.atData(i) == 0){
+                if(cost < std::numeric_limits<float>::infinity()){
+                    overlaidCost.emplace(i, cost);
+                    cost = std::numeric_limits<float>::infinity();
+                }
+            }else if(auto it = overlaidCost.find(i); it != overlaidCost.end()){
+                cost = it->second;
+                overlaidCost.erase(it);
+            }
+        }
+    }
+    onCostMapChanged(x0, y0, x1, y1);
+    return Region{x0, y0, x1-x0, y1-y0};
+}
+
+std::vector<float> AStar::buildDecayTable(int r, float _costWeight, const std::function<float(float)>& _decayFunction) const {
+    // 衰减函数只在这里调用r^2次，之后都是查表
+    std::vector<float> table(static_cast<size_t>(r)*r + 1, _costWeight);
+    for(size_t d2=1; d2<table.size(); d2++){
+        float d = _decayFunction(quickSqrt(static_cast<float>(d2)) * mapping);
+        if(d > 1.f){
+            table[d2] = d * _costWeight;
+        }
+    }
+    return table;
+}
+
+void AStar::inflateEDT(int x0, int y0, int x1, int y1, int ox0, int oy0, int ox1, int oy1, const std::vector<float>& decayTable, float _costWeight){
+    int w = x1 - x0, h = y1 - y0;
+    int width = originMap.shape(1);
+    constexpr int farAway = 1 << 29;// 这一列没有障碍物
+    // 第一遍：按列求到最近障碍物的纵向距离。按行扫描保证访存连续，列方向分块并行
+    std::vector<int> colDist(static_cast<size_t>(w)*h);
+    constexpr int strip = 256;
+    auto strips = std::views::iota(0, (w + strip - 1) / strip);
+    std::for_each(std::execution::par, strips.begin(), strips.end(), [&](int s){
+        int c0 = s*strip, c1 = std::min(w, c0+strip);
+        for(int y=0; y<h; y++){
+            const u_char* src = originMap.data + static_cast<size_t>(y+y0)*width + x0;
+            int* row = colDist.data() + static_cast<size_t>(y)*w;
+            const int* prev = row - w;
+            for(int x=c0; x<c1; x++){
+                row[x] = src[x] == 0 ? 0 : (y == 0 ? farAway : std::min(prev[x] + 1, farAway));
+            }
+        }
+        for(int y=h-2; y>=0; y--){
+            int* row = colDist.data() + static_cast<size_t>(y)*w;
+            const int* next = row + w;
+            for(int x=c0; x<c1; x++){
+                row[x] = std::min(row[x], next[x] + 1);
+            }
+        }
+    });
+    // 第二遍：逐行求抛物线下包络（Felzenszwalb-Huttenlocher），得到距离平方并查表，行间并行
+    double maxDist2 = static_cast<double>(decayTable.size() - 1);
+    auto rows = std::views::iota(oy0, oy1);
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y){
+        std::vector<double> f(w), z(w+1);
+        std::vector<int> v(w);
+        const int* col = colDist.data() + static_cast<size_t>(y-y0)*w;
+        for(int q=0; q<w; q++){
+            f[q] = col[q] >= farAway ? 1e20 : static_cast<double>(col[q])*col[q];
+        }
+        int k = 0;
+        v[0] = 0;
+        z[0] = -std::numeric_limits<double>::infinity();
+        z[1] = std::numeric_limits<double>::infinity();
+        for(int q=1; q<w; q++){
+            double s = ((f[q] + static_cast<double>(q)*q) - (f[v[k]] + static_cast<double>(v[k])*v[k])) / (2.0*q - 2.0*v[k]);
+            while(s <= z[k]){
+                k--;
+                s = ((f[q] + static_cast<double>(q)*q) - (f[v[k]] + static_cast<double>(v[k])*v[k])) / (2.0*q - 2.0*v[k]);
+            }
+            k++;
+            v[k] = q;
+            z[k] = s;
+            z[k+1] = std::numeric_limits<double>::infinity();
+        }
+        k = 0;
+        float* out = costMap.data + static_cast<size_t>(y)*width;
+        const u_char* src = originMap.data + static_cast<size_t>(y)*width;
+        for(int q=0; q<w; q++){
+            while(z[k+1] < q) k++;
+            int x = q + x0;
+            if(x < ox0 || x >= ox1) continue;
+            if(src[x] == 0){
+                out[x] = std::numeric_limits<float>::infinity();
+                continue;
+            }
+            double d2 = static_cast<double>(q - v[k])*(q - v[k]) + f[v[k]];
+            out[x] = d2 <= maxDist2 ? decayTable[static_cast<size_t>(d2)] : _costWeight;
+        }
+    });
+}
+
+void AStar::buildJumpMap(){
+    int h = costMap.shape(0), w = costMap.shape(1);
+    jumpMap = YTensor<JumpCell,2>(h, w);
+    uniformCost = std::numeric_limits<float>::infinity();
+    for(size_t a=0; a<costMap.size(); a++){
+        uniformCost = std::min(uniformCost, costMap.atData(a));
+    }
+    // 格子分类
+    for(size_t a=0; a<costMap.size(); a++){
+        float c = costMap.atData(a);
+        jumpMap.atData(a).type = !(c < std::numeric_limits<float>::infinity()) ? JumpCell::Wall : (c == uniformCost ? JumpCell::Uniform : JumpCell::Weighted);
+    }
+    auto blocked = [&](int x, int y){
+        if(x<0 || x>=w || y<0 || y>=h) return true;
+        u_char t = jumpMap.atData(y*w+x).type;
+        return t != JumpCell::Uniform && t != JumpCell::Border;
+    };
+    for(int y=0; y<h; y++){
+        for(int x=0; x<w; x++){
+            auto& cell = jumpMap.atData(y*w+x);
+            if(cell.type != JumpCell::Uniform) continue;
+            for(int i=0; i<8; i++){
+                int nx = x+neighour[i][1], ny = y+neighour[i][0];
+                if(nx>=0 && nx<w && ny>=0 && ny<h && jumpMap.atData(ny*w+nx).type == JumpCell::Weighted){
+                    cell.type = JumpCell::Border;
+                    break;
+                }
+            }
+        }
+    }
+    // 沿(dx, dy)方向到达(x, y)时是否为跳点（有强迫邻居，或紧邻膨胀区域）
+    auto isJumpPoint = [&](int x, int y, int dx, int dy){
+        if(jumpMap.atData(y*w+x).type == JumpCell::Border) return true;
+        if(dx != 0 && dy != 0){
+            return (blocked(x-dx, y) && !blocked(x-dx, y+dy)) || (blocked(x, y-dy) && !blocked(x+dx, y-dy));
+        }
+        if(dx != 0){
+            return (blocked(x, y+1) && !blocked(x+dx, y+1)) || (blocked(x, y-1) && !blocked(x+dx, y-1));
+        }
+        return (blocked(x+1, y) && !blocked(x+1, y+dy)) || (blocked(x-1, y) && !blocked(x-1, y+dy));
+    };
+    // 先算直行方向，斜行方向依赖直行的结果。扫描顺序保证(x+dx, y+dy)先于(x, y)算出
+    for(int i=0; i<8; i++){
+        int dy = neighour[i][0], dx = neighour[i][1];
+        int y0 = dy>0 ? h-1 : 0, y1 = dy>0 ? -1 : h, ys = dy>0 ? -1 : 1;
+        int x0 = dx>0 ? w-1 : 0, x1 = dx>0 ? -1 : w, xs = dx>0 ? -1 : 1;
+        for(int y=y0; y!=y1; y+=ys){
+            for(int x=x0; x!=x1; x+=xs){
+                auto& cell = jumpMap.atData(y*w+x);
+                if(blocked(x, y)){
+                    cell.dist[i] = 0;
+                    continue;
+                }
+                int nx = x+dx, ny = y+dy, v;
+                if(blocked(nx, ny)){
+                    v = 0;
+                }else{
+                    auto& next = jumpMap.atData(ny*w+nx);
+                    if(isJumpPoint(nx, ny, dx, dy) || (i >= 4 && (next.dist[neighourOf[1][dx+1]] > 0 || next.dist[neighourOf[dy+1][1]] > 0))){
+                        v = 1;
+                    }else{
+                        v = next.dist[i] > 0 ? next.dist[i] + 1 : next.dist[i] - 1;
+                    }
+                }
+                // 超出short范围时截断为一个普通的中间节点，搜索时会按自然邻居继续前进
+                cell.dist[i] = (v > SHRT_MAX || v < -SHRT_MAX) ? SHRT_MAX : v;
             }
         }
-        return _costWeight;
+    }
+    jumpMapDirty = false;
+}
+
+std::vector<std::pair<float,float>> AStar::search(std::pair<float, float> start, std::pair<float, float> end, SearchStats* stats){
+    prepare();
+    return search(context, start, end, stats);
+}
+
+std::vector<std::pair<float,float>> AStar::search(SearchContext& ctx, std::pair<float, float> start, std::pair<float, float> end, [[maybe_unused]] SearchStats* stats) const {
+#if YASTAR_STATS
+    auto t0 = stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+#endif
+    if(ctx.hotMap.data == nullptr || ctx.hotMap.shape(0) != originMap.shape(0) || ctx.hotMap.shape(1) != originMap.shape(1)){
+        ctx.resize(originMap.shape(1), originMap.shape(0));
+    }
+    ctx.reset();// 只推进代次，O(1)
+#if YASTAR_STATS
+    ctx.stats = stats;
+    if(stats){
+        *stats = SearchStats();
+        stats->resetSeconds = secondsSince(t0);
+    }
+#endif
+    int width = originMap.shape(1);
+    size_t startIndex = static_cast<size_t>(start.second/mapping)*width + static_cast<size_t>(start.first/mapping);
+    size_t endIndex = static_cast<size_t>(end.second/mapping)*width + static_cast<size_t>(end.first/mapping);
+    if((traditional || ctx.traditional8) && !maybeConnected(startIndex, endIndex)){
+        // 起点终点不在同一个连通分量，不需要搜索（动量模式的步长可能越过障碍物，不做判断）
+        if(!ctx.quiet) std::cout<<"No path found!"<<std::endl;
+        return std::vector<std::pair<float, float>>();
+    }
+    if(queuePolicy == QueuePolicy::Bucket && costQuantum > 0.f){
+        // 整数代价地图，使用桶队列
+        BucketOpenList openList(bucketWidth > 0.f ? bucketWidth : costQuantum, NodeHeapPos{&ctx.heapPosMap});
+        return dispatchCost(ctx, openList, start, end);
+    }
+    // 创建4叉最小堆(index存储，缓存f值，支持decrease-key)
+    OpenList openList(NodeHeapPos{&ctx.heapPosMap});
+    return dispatchCost(ctx, openList, start, end);
+}
+
+template<typename Queue>
+std::vector<std::pair<float,float>> AStar::dispatchCost(SearchContext& ctx, Queue& openList, std::pair<float, float> start, std::pair<float, float> end) const {
+    if(costStorage == CostStorage::Quant8 && costMap8.data != nullptr){
+        return dispatchHeuristic(ctx, openList, Quant8Cost{costMap8.data, quant8Step}, start, end);
+    }
+    if(costStorage == CostStorage::BFloat16 && costMap16.data != nullptr){
+        return dispatchHeuristic(ctx, openList, BFloat16Cost{costMap16.data}, start, end);
+    }
+    return dispatchHeuristic(ctx, openList, FloatCost{costMap.data}, start, end);
+}
+
+template<typename Queue, typename Cost>
+std::vector<std::pair<float,float>> AStar::dispatchHeuristic(SearchContext& ctx, Queue& openList, const Cost& cost, std::pair<float, float> start, std::pair<float, float> end) const {
+    if(heuristic == HeuristicPolicy::Octile){
+        return dispatchNeighbours<Queue, OctileHeuristic>(ctx, openList, cost, start, end);
+    }
+    return dispatchNeighbours<Queue, EuclideanHeuristic>(ctx, openList, cost, start, end);
+}
+
+template<typename Queue, typename Heuristic, typename Cost>
+std::vector<std::pair<float,float>> AStar::dispatchNeighbours(SearchContext& ctx, Queue& openList, const Cost& cost, std::pair<float, float> start, std::pair<float, float> end) const {
+    if(ctx.traditional8){
+        return searchWith<Queue, Heuristic, 8>(ctx, openList, cost, start, end);
+    }
+    if(!traditional){
+        return searchWith<Queue, Heuristic, MomentumNeighbours>(ctx, openList, cost, start, end);
+    }
+    switch(std::clamp(neighourCount, 4, 8)){
+        case 4: return searchWith<Queue, Heuristic, 4>(ctx, openList, cost, start, end);
+        case 8: return searchWith<Queue, Heuristic, 8>(ctx, openList, cost, start, end);
+        default: return searchWith<Queue, Heuristic, RuntimeNeighbours>(ctx, openList, cost, start, end);
+    }
+}
+
+std::vector<std::vector<std::pair<float,float>>> AStar::searchBatch(const std::vector<std::pair<std::pair<float, float>, std::pair<float, float>>>& queries, int threadCount, std::vector<SearchStats>* stats){
+    std::vector<std::vector<std::pair<float,float>>> paths(queries.size());
+    if(stats) stats->assign(queries.size(), SearchStats());
+    if(queries.empty()) return paths;
+    prepare();// 预计算在并行搜索前完成，之后所有工作者只读地图
+    if(threadCount <= 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = static_cast<int>(std::min<size_t>(threadCount, queries.size()));
+    while(batchContexts.size() < static_cast<size_t>(threadCount)){
+        batchContexts.push_back(std::make_unique<SearchContext>());
+    }
+    // 工作线程取自并行算法的线程池（TBB），不在每次调用时创建线程；
+    // 每个工作者用一个原子下标领取下一条查询，先做完的自然多领，不需要预先分块
+    std::atomic<size_t> next{0};
+    auto ids = std::views::iota(0, threadCount);
+    std::for_each(std::execution::par, ids.begin(), ids.end(), [&](int id){
+        SearchContext& ctx = *batchContexts[id];
+        for(size_t job = next.fetch_add(1, std::memory_order_relaxed); job < queries.size(); job = next.fetch_add(1, std::memory_order_relaxed)){
+            paths[job] = search(ctx, queries[job].first, queries[job].second, stats ? &(*stats)[job] : nullptr);
+        }
     });
-    costMap = temp;
+    return paths;
 }
 
-std::vector<std::pair<float,float>> AStar::search(std::pair<float, float> start, std::pair<float, float> end){
-    if(!reseted){
-        reset();
+void AStar::prepare(){
+    if(jumpPointSearch && traditional && jumpMapDirty){
+        buildJumpMap();
+    }
+    if(componentsDirty && costMap.data != nullptr){
+        buildComponents();
     }
-    // 创建最大堆(index存储)
-    std::priority_queue<size_t, std::vector<size_t>, CompareNode> openList(CompareNode(nodeMap, std::placeholders::_1));
+}
+
+template<typename Queue, typename Heuristic, int Neighbours, typename Cost>
+std::vector<std::pair<float,float>> AStar::searchWith(SearchContext& ctx, Queue& openList, const Cost& cost, std::pair<float, float> start, std::pair<float, float> end) const {
+    // 桶队列的弹出顺序不精确，需要允许重新打开闭集节点才能保证误差界
+    constexpr bool reopen = std::is_same_v<Queue, BucketOpenList>;
+    constexpr bool momentum = Neighbours == MomentumNeighbours;
     int startx = start.first/mapping, starty = start.second/mapping;// 起点
     int endx = end.first/mapping, endy = end.second/mapping;// 终点
-    int traditionalNeighourCount = std::clamp(neighourCount, 4, 8);
+    // 固定邻居数时循环次数是编译期常量，编译器可以完全展开
+    const int traditionalNeighourCount = Neighbours > 0 ? Neighbours : std::clamp(neighourCount, 4, 8);
+    // 跳点搜索，跳跃距离按整张地图预计算，所以限制了搜索窗口或跳点表过期时不使用
+    const bool useJump = Neighbours == 8 && jumpPointSearch && !jumpMapDirty && ctx.windowX0 == 0 && ctx.windowY0 == 0 && ctx.windowX1 == ctx.hotMap.shape(1) && ctx.windowY1 == ctx.hotMap.shape(0);
     float mappedStride = stride/mapping;// 映射后的步长
     float mappedSpeed = speed/mapping;// 映射后的最大速度
     float mappedTogether=mappedStride+mappedSpeed;
-    std::vector<float> angles(neighourCount);
-    for(int i=0;i<neighourCount;i++){
-        angles[i] = i*2*M_PI/neighourCount;
+    int speedCount = 2*motionHalf+1;
+    int restState = motionHalf*speedCount+motionHalf;// 速度为0的状态
+    int width = ctx.hotMap.shape(1), height = ctx.hotMap.shape(0);
+    if(momentum && (ctx.motionMap.data == nullptr || ctx.motionMap.shape(0) != height || ctx.motionMap.shape(1) != width)){
+        // 速度只有考虑动量时才用到，需要时再分配
+        ctx.motionMap = YTensor<int,2>(height, width);
     }
-    Node startNode(0, std::hypotf(startx-endx,starty-endy), -1);
-    nodeMap[starty][startx] = startNode;
-    openList.push(starty*nodeMap.shape(1)+startx);
+    size_t startIndex = starty*width+startx;
+    SearchCounter counter(ctx.stats);
+    ctx.touchNode(startIndex).cost = 0;
+    ctx.parentMap.data[startIndex] = -1;
+    if(momentum) ctx.motionMap.data[startIndex] = restState;
+    openList.push(startIndex, Heuristic::exact(startx-endx, starty-endy));
+    counter.push();
+    auto staleOf = [&]() -> size_t {
+        if constexpr(reopen) return openList.stale;// 只有桶队列会产生过期条目
+        else return 0;
+    };
+    // 启发代价不存储，按节点最后一次由哪个分支更新现算
+    auto estimOf = [&](size_t index, int x, int y, const HotNode& nd){
+        if(index == startIndex) return Heuristic::exact(startx-endx, starty-endy);
+        float estim = Heuristic::distance(x - endx, y - endy);
+        return (nd.tag & HotNode::pixelBit) ? estim : estim * mapping;
+    };
     while(!openList.empty()){
-        size_t index = openList.top();
-        openList.pop();
-        int y = index/nodeMap.shape(1), x = index%nodeMap.shape(1);
+        counter.open(openList.size());
+        size_t index = openList.pop();
+        counter.expand();
+        int y = index/width, x = index%width;
         if(x==endx && y==endy){
             // 找到终点
+            counter.searchDone();
             std::vector<std::pair<float, float>> path;
             while(index!=-1){
                 path.push_back(std::make_pair(x*mapping, y*mapping));
-                index = nodeMap.atData(index).parent;
+                index = ctx.parentMap.data[index];
                 if(index==-1){
                     break;
                 }
-                x = index%nodeMap.shape(1);
-                y = index/nodeMap.shape(1);
+                int px = index%width, py = index/width;
+                if(useJump){
+                    // 补上跳过的中间格子
+                    int sx = (px>x) - (px<x), sy = (py>y) - (py<y);
+                    for(int cx=x+sx, cy=y+sy; cx!=px || cy!=py; cx+=sx, cy+=sy){
+                        path.push_back(std::make_pair(cx*mapping, cy*mapping));
+                    }
+                }
+                x = px;
+                y = py;
             }
             std::reverse(path.begin(), path.end());
+            counter.finish(true, staleOf(), ctx.touched);
             return path;
         }
-        nodeMap.atData(index).closed = true;// 标记为已关闭
-        if(traditional || nodeMap.atData(index).estim<mappedTogether){
-            // 传统A*算法 or 临近终点
-            static constexpr int neighour[8][2] = {{-1,0},{1,0},{0,-1},{0,1},{-1,-1},{-1,1},{1,-1},{1,1}};
+        HotNode& cur = ctx.hotMap.data[index];
+        cur.tag |= HotNode::closedBit;// 标记为已关闭
+        if(useJump && jumpMap.atData(index).type != JumpCell::Weighted){
+            // 跳点搜索(JPS+)，只在均匀代价区域内跳跃
+            const JumpCell& jc = jumpMap.atData(index);
+            float cost0 = cur.cost;
+            auto relax = [&](int nx, int ny, int steps, int i){
+                size_t nindex = ny*width+nx;
+                auto& nd = ctx.touchNode(nindex);
+                if(nd.closed() && !reopen)return;
+                float newCost = cost0 + cost(nindex) * steps * (1.f + static_cast<int>(i/4)*0.414f);
+                if(newCost<nd.cost){
+                    nd.cost = newCost;
+                    nd.tag &= ~HotNode::closedBit;
+                    ctx.parentMap.data[nindex] = index;
+                    openList.pushOrUpdate(nindex, newCost + Heuristic::distance(nx - endx, ny - endy));
+                    counter.push();
+                }
+            };
+            auto blocked = [&](int bx, int by){
+                if(bx<0 || bx>=width || by<0 || by>=height) return true;
+                u_char t = jumpMap.atData(by*width+bx).type;
+                return t != JumpCell::Uniform && t != JumpCell::Border;
+            };
+            // 选出需要跳跃的方向
+            int dirMask = 0;
+            int parent = ctx.parentMap.data[index];
+            if(parent < 0 || jc.type == JumpCell::Border || jumpMap.atData(parent).type == JumpCell::Weighted){
+                dirMask = 0xFF;// 起点、紧邻膨胀区域或刚离开膨胀区域，全方向
+            }else{
+                int px = parent%width, py = parent/width;
+                int dx = (x>px) - (x<px), dy = (y>py) - (y<py);
+                if(dx != 0 && dy != 0){
+                    dirMask |= (1 << neighourOf[1][dx+1]) | (1 << neighourOf[dy+1][1]) | (1 << neighourOf[dy+1][dx+1]);
+                    if(blocked(x-dx, y) && !blocked(x-dx, y+dy)) dirMask |= 1 << neighourOf[dy+1][-dx+1];
+                    if(blocked(x, y-dy) && !blocked(x+dx, y-dy)) dirMask |= 1 << neighourOf[-dy+1][dx+1];
+                }else if(dx != 0){
+                    dirMask |= 1 << neighourOf[1][dx+1];
+                    if(blocked(x, y+1) && !blocked(x+dx, y+1)) dirMask |= 1 << neighourOf[2][dx+1];
+                    if(blocked(x, y-1) && !blocked(x+dx, y-1)) dirMask |= 1 << neighourOf[0][dx+1];
+                }else{
+                    dirMask |= 1 << neighourOf[dy+1][1];
+                    if(blocked(x+1, y) && !blocked(x+1, y+dy)) dirMask |= 1 << neighourOf[dy+1][2];
+                    if(blocked(x-1, y) && !blocked(x-1, y+dy)) dirMask |= 1 << neighourOf[dy+1][0];
+                }
+            }
+            int gdx = endx - x, gdy = endy - y;
+            for(int i = 0; i < 8; i++){
+                if(!(dirMask & (1 << i)))continue;
+                int dy = neighour[i][0], dx = neighour[i][1];
+                int dist = jc.dist[i];
+                int reach = dist > 0 ? dist : -dist;// 沿该方向连续可走的步数
+                // 终点落在跳跃范围内
+                if(i < 4){
+                    int along = dx != 0 ? gdx*dx : gdy*dy;
+                    int across = dx != 0 ? gdy : gdx;
+                    if(across == 0 && along > 0 && along <= reach){
+                        relax(endx, endy, along, i);
+                        continue;
+                    }
+                }else if(gdx*dx > 0 && gdy*dy > 0){
+                    int k = std::min(gdx*dx, gdy*dy);
+                    if(k <= reach){
+                        relax(x+k*dx, y+k*dy, k, i);// 到达终点所在的行或列
+                        continue;
+                    }
+                }
+                if(dist > 0){
+                    relax(x+dist*dx, y+dist*dy, dist, i);
+                }
+            }
+            if(jc.type == JumpCell::Border){
+                // 逐格进入膨胀区域
+                for(int i = 0; i < 8; i++){
+                    int nx = x+neighour[i][1], ny = y+neighour[i][0];
+                    if(nx>=0 && nx<width && ny>=0 && ny<height && jumpMap.atData(ny*width+nx).type == JumpCell::Weighted){
+                        relax(nx, ny, 1, i);
+                    }
+                }
+            }
+        }
+        else if(!momentum || estimOf(index, x, y, cur)<mappedTogether){
+            // 传统A*算法 or 临近终点 or 跳点搜索中的膨胀区域
             for (int i = 0; i < traditionalNeighourCount; i++){
                 int nx=x+neighour[i][1], ny=y+neighour[i][0];
-                size_t nindex=ny*nodeMap.shape(1)+nx;
-                if(nx>=0 && nx<nodeMap.shape(1) && ny>=0 && ny<nodeMap.shape(0)){
-                    if(costMap.atData(nindex)<std::numeric_limits<float>::infinity()){
-                        auto& nd=nodeMap.atData(nindex);
-                        if(nd.closed)continue;
-                        float newCost = nodeMap.atData(index).cost + costMap.atData(nindex) * (1.f + static_cast<int>(i/4)*0.414f);// 分支优化最终版本！
+                size_t nindex=ny*width+nx;
+                if(ctx.inWindow(nx, ny)){
+                    if(!isBlocked(nx, ny)){
+                        auto& nd=ctx.touchNode(nindex);
+                        if(nd.closed() && !reopen)continue;
+                        float newCost = cur.cost + cost(nindex) * (1.f + static_cast<int>(i/4)*0.414f);// 分支优化最终版本！
                         if(newCost<nd.cost){
+                            if(momentum && !(nd.cost < std::numeric_limits<float>::infinity())){
+                                ctx.motionMap.data[nindex] = restState;// 第一次访问，速度为0
+                            }
                             nd.cost = newCost;
-                            nd.estim = quickSqrt((nx - endx) * (nx - endx) + (ny - endy) * (ny - endy));
-                            // nd.estim = std::hypotf(nx - endx, ny - endy);// 变慢了！！！
-                            nd.parent = index;
-                            openList.push(nindex);
+                            nd.tag = (nd.tag & ~HotNode::closedBit) | HotNode::pixelBit;
+                            ctx.parentMap.data[nindex] = index;
+                            float estim = Heuristic::distance(nx - endx, ny - endy);
+                            // float estim = std::hypotf(nx - endx, ny - endy);// 变慢了！！！
+                            openList.pushOrUpdate(nindex, newCost + estim);
+                            counter.push();
                         }
                     }
                 }
@@ -319,30 +1091,30 @@ std::vector<std::pair<float,float>> AStar::search(std::pair<float, float> start,
         }// 初始blast算法没有任何改进
         else{
             // 考虑车车动量的A*算法，更慢但是更快（指实际行走）
-            float forx=nodeMap.atData(index).speedx, fory=nodeMap.atData(index).speedy;
-            float angle0 = std::atan2(fory, forx);// 速度方向角度
-            // constexpr float angle0 = 0.f;// 轨迹质量严重下降，如果关闭这个
+            // 邻居偏移按速度状态查表（buildMotionTable），循环里不再有三角函数
+            int state = ctx.motionMap.data[index];
+            float forx = motionSpeeds[state%speedCount], fory = motionSpeeds[state/speedCount];
             forx += x;
             fory += y; // 现在表示速度方向后x的位置
+            const std::pair<float,float>* offsets = &motionOffsets[static_cast<size_t>(state)*neighourCount];
             for(int i=0;i<neighourCount;i++){
-                float angle = angles[i] + angle0; // 邻居角度（已考虑方向）
-                int nx = forx + mappedStride * quickSqrt(1 / (1 + std::tan(angle) * std::tan(angle))) * std::cos(angle);
-                int ny = fory + mappedStride * quickSqrt(1 / (1 + std::tan(angle) * std::tan(angle))) * std::sin(angle); // 求解的最终邻居位置，且距离代价理应相等
-                size_t nindex = ny*nodeMap.shape(1)+nx;
-                if(nx>=0 && nx<nodeMap.shape(1) && ny>=0 && ny<nodeMap.shape(0)){
-                    if(costMap.atData(nindex)<std::numeric_limits<float>::infinity()){
+                int nx = forx + offsets[i].first;
+                int ny = fory + offsets[i].second; // 求解的最终邻居位置
+                size_t nindex = ny*width+nx;
+                if(ctx.inWindow(nx, ny)){
+                    if(!isBlocked(nx, ny)){
                         // 能走
-                        auto& nd = nodeMap.atData(nindex);
-                        if(nd.closed)continue;
-                        float newCost = nodeMap.atData(index).cost + stride * costMap.atData(nindex); // costWeight 在初始化处已经乘过了
+                        auto& nd = ctx.touchNode(nindex);
+                        if(nd.closed() && !reopen)continue;
+                        float newCost = cur.cost + stride * cost(nindex); // costWeight 在初始化处已经乘过了
                         if(newCost< nd.cost){
                             // 不管是不是open都可以更新。
                             nd.cost = newCost;
-                            nd.estim = quickSqrt((nx - endx) * (nx - endx) + (ny - endy) * (ny - endy)) * mapping;
-                            nd.parent = index;
-                            nd.speedx = std::clamp(static_cast<float>(nx - x), -mappedSpeed, mappedSpeed);
-                            nd.speedy = std::clamp(static_cast<float>(ny - y), -mappedSpeed, mappedSpeed);
-                            openList.push(nindex);
+                            nd.tag &= ~(HotNode::closedBit | HotNode::pixelBit);
+                            ctx.parentMap.data[nindex] = index;
+                            ctx.motionMap.data[nindex] = speedIndex(ny - y)*speedCount + speedIndex(nx - x);
+                            openList.pushOrUpdate(nindex, newCost + Heuristic::distance(nx - endx, ny - endy) * mapping);
+                            counter.push();
                         }
                     }
                 }
@@ -351,12 +1123,356 @@ std::vector<std::pair<float,float>> AStar::search(std::pair<float, float> start,
 
     }
     // 未找到路径
-    std::cout<<"No path found!"<<std::endl;
+    counter.finish(false, staleOf(), ctx.touched);
+    if(!ctx.quiet) std::cout<<"No path found!"<<std::endl;
     return std::vector<std::pair<float, float>>();
 }
 
+std::vector<std::pair<float,float>> AStar::searchWithDeadline(std::pair<float, float> start, std::pair<float, float> end, float budgetSeconds, float initialWeight, float weightStep, float* achievedWeight){
+    if(context.hotMap.data == nullptr || context.hotMap.shape(0) != originMap.shape(0) || context.hotMap.shape(1) != originMap.shape(1)){
+        context.resize(originMap.shape(1), originMap.shape(0));
+    }
+    context.reset();
+    context.stats = nullptr;
+    auto withCost = [&](const auto& cost){
+        if(heuristic == HeuristicPolicy::Octile){
+            return anytimeWith<OctileHeuristic>(context, cost, start, end, budgetSeconds, initialWeight, weightStep, achievedWeight);
+        }
+        return anytimeWith<EuclideanHeuristic>(context, cost, start, end, budgetSeconds, initialWeight, weightStep, achievedWeight);
+    };
+    if(costStorage == CostStorage::Quant8 && costMap8.data != nullptr){
+        return withCost(Quant8Cost{costMap8.data, quant8Step});
+    }
+    if(costStorage == CostStorage::BFloat16 && costMap16.data != nullptr){
+        return withCost(BFloat16Cost{costMap16.data});
+    }
+    return withCost(FloatCost{costMap.data});
+}
+
+std::vector<std::pair<float,float>> AStar::search(std::pair<float, float> start, const std::vector<std::pair<float, float>>& goals, int* goalIndex){
+    if(goalIndex) *goalIndex = -1;
+    prepare();
+    if(context.hotMap.data == nullptr || context.hotMap.shape(0) != originMap.shape(0) || context.hotMap.shape(1) != originMap.shape(1)){
+        context.resize(originMap.shape(1), originMap.shape(0));
+    }
+    context.reset();
+    context.stats = nullptr;
+    auto withCost = [&](const auto& cost){
+        if(heuristic == HeuristicPolicy::Octile){
+            return multiGoalWith<OctileHeuristic>(context, cost, start, goals, false, goalIndex, nullptr);
+        }
+        return multiGoalWith<EuclideanHeuristic>(context, cost, start, goals, false, goalIndex, nullptr);
+    };
+    if(costStorage == CostStorage::Quant8 && costMap8.data != nullptr){
+        return withCost(Quant8Cost{costMap8.data, quant8Step});
+    }
+    if(costStorage == CostStorage::BFloat16 && costMap16.data != nullptr){
+        return withCost(BFloat16Cost{costMap16.data});
+    }
+    return withCost(FloatCost{costMap.data});
+}
+
+std::vector<float> AStar::searchCosts(std::pair<float, float> start, const std::vector<std::pair<float, float>>& goals){
+    std::vector<float> costs(goals.size(), std::numeric_limits<float>::infinity());
+    prepare();
+    if(context.hotMap.data == nullptr || context.hotMap.shape(0) != originMap.shape(0) || context.hotMap.shape(1) != originMap.shape(1)){
+        context.resize(originMap.shape(1), originMap.shape(0));
+    }
+    context.reset();
+    context.stats = nullptr;
+    auto withCost = [&](const auto& cost){
+        if(heuristic == HeuristicPolicy::Octile){
+            multiGoalWith<OctileHeuristic>(context, cost, start, goals, true, nullptr, &costs);
+        }else{
+            multiGoalWith<EuclideanHeuristic>(context, cost, start, goals, true, nullptr, &costs);
+        }
+    };
+    if(costStorage == CostStorage::Quant8 && costMap8.data != nullptr){
+        withCost(Quant8Cost{costMap8.data, quant8Step});
+    }else if(costStorage == CostStorage::BFloat16 && costMap16.data != nullptr){
+        withCost(BFloat16Cost{costMap16.data});
+    }else{
+        withCost(FloatCost{costMap.data});
+    }
+    return costs;
+}
+
+template<typename Heuristic, typename Cost>
+std::vector<std::pair<float,float>> AStar::multiGoalWith(SearchContext& ctx, const Cost& cost, std::pair<float, float> start, const std::vector<std::pair<float, float>>& goals, bool all, int* goalIndex, std::vector<float>* costs) const {
+    int width = ctx.hotMap.shape(1), height = ctx.hotMap.shape(0);
+    int startx = start.first/mapping, starty = start.second/mapping;// 起点
+    size_t startIndex = static_cast<size_t>(starty)*width+startx;
+    const int count = std::clamp(neighourCount, 4, 8);
+    // 目标按格子编号排序，弹出节点时二分查找；不可达（不同连通分量）的目标直接去掉
+    std::vector<std::pair<size_t, int>> targets;
+    std::vector<int> gx, gy;// 可达目标的坐标（SoA），计算启发函数用
+    for(size_t k=0;k<goals.size();k++){
+        int x = goals[k].first/mapping, y = goals[k].second/mapping;
+        if(x < 0 || x >= width || y < 0 || y >= height) continue;
+        size_t index = static_cast<size_t>(y)*width+x;
+        if(!maybeConnected(startIndex, index)) continue;
+        targets.push_back(std::make_pair(index, static_cast<int>(k)));
+        gx.push_back(x);
+        gy.push_back(y);
+    }
+    std::sort(targets.begin(), targets.end());
+    size_t remaining = targets.size();// 还没有关闭的目标数（all模式）
+    if(remaining == 0){
+        return std::vector<std::pair<float, float>>();
+    }
+
+    OpenList openList(NodeHeapPos{&ctx.heapPosMap});
+    ctx.touchNode(startIndex).cost = 0;
+    ctx.parentMap.data[startIndex] = -1;
+    openList.push(startIndex, Heuristic::nearest(startx, starty, gx.data(), gy.data(), gx.size()));
+    while(!openList.empty()){
+        size_t index = openList.pop();
+        int y = index/width, x = index%width;
+        HotNode& cur = ctx.hotMap.data[index];
+        cur.tag |= HotNode::closedBit;
+        auto hit = std::equal_range(targets.begin(), targets.end(), std::make_pair(index, 0),
+            [](const auto& a, const auto& b){ return a.first < b.first; });
+        if(hit.first != hit.second){
+            if(!all){
+                std::vector<std::pair<float, float>> path;
+                for(long p = index; p != -1; p = ctx.parentMap.data[p]){
+                    path.push_back(std::make_pair(p%width*mapping, p/width*mapping));
+                }
+                std::reverse(path.begin(), path.end());
+                if(goalIndex) *goalIndex = hit.first->second;
+                return path;
+            }
+            for(auto it = hit.first; it != hit.second; it++){
+                (*costs)[it->second] = cur.cost;
+                remaining--;
+            }
+            if(remaining == 0) break;
+        }
+        for(int i = 0; i < count; i++){
+            int nx = x+neighour[i][1], ny = y+neighour[i][0];
+            if(!ctx.inWindow(nx, ny) || isBlocked(nx, ny)) continue;
+            size_t nindex = ny*width+nx;
+            auto& nd = ctx.touchNode(nindex);
+            if(nd.closed()) continue;
+            float newCost = cur.cost + cost(nindex) * (1.f + static_cast<int>(i/4)*0.414f);
+            if(newCost < nd.cost){
+                nd.cost = newCost;
+                ctx.parentMap.data[nindex] = index;
+                openList.pushOrUpdate(nindex, newCost + Heuristic::nearest(nx, ny, gx.data(), gy.data(), gx.size()));
+            }
+        }
+    }
+    return std::vector<std::pair<float, float>>();
+}
+
+template<typename Heuristic, typename Cost>
+std::vector<std::pair<float,float>> AStar::anytimeWith(SearchContext& ctx, const Cost& cost, std::pair<float, float> start, std::pair<float, float> end, float budgetSeconds, float initialWeight, float weightStep, float* achievedWeight) const {
+    auto t0 = std::chrono::steady_clock::now();
+    int startx = start.first/mapping, starty = start.second/mapping;// 起点
+    int endx = end.first/mapping, endy = end.second/mapping;// 终点
+    int width = ctx.hotMap.shape(1);
+    const int count = std::clamp(neighourCount, 4, 8);
+    size_t startIndex = starty*width+startx, endIndex = endy*width+endx;
+    if(achievedWeight) *achievedWeight = 0.f;
+    if(!maybeConnected(startIndex, endIndex)){
+        return std::vector<std::pair<float, float>>();
+    }
+    float estimWeight = std::max(initialWeight, 1.f);// 启发权重
+    weightStep = std::max(weightStep, 1e-3f);
+    auto keyOf = [&](size_t index){
+        return ctx.hotMap.data[index].cost + estimWeight * Heuristic::distance(static_cast<int>(index%width) - endx, static_cast<int>(index/width) - endy);
+    };
+
+    OpenList openList(NodeHeapPos{&ctx.heapPosMap});
+    std::vector<size_t> closed;// 本轮关闭的节点，下一轮开始前清除闭集标记
+    std::vector<size_t> incons;// 已关闭后代价又降低的节点（不一致节点），下一轮放回开集
+    ctx.touchNode(startIndex).cost = 0;
+    ctx.parentMap.data[startIndex] = -1;
+    ctx.touchNode(endIndex);
+    openList.push(startIndex, keyOf(startIndex));
+
+    std::vector<std::pair<float, float>> best;
+    int checkCounter = 0;
+    bool timeout = false;
+    while(true){
+        // ImprovePath：终点的代价不大于开集最小键值时，当前权重下的路径已经确定
+        while(!openList.empty() && !(ctx.hotMap.data[endIndex].cost <= openList.top().key)){
+            if(++checkCounter == 64){
+                checkCounter = 0;
+                if(secondsSince(t0) >= budgetSeconds){
+                    timeout = true;
+                    break;
+                }
+            }
+            size_t index = openList.pop();
+            int y = index/width, x = index%width;
+            HotNode& cur = ctx.hotMap.data[index];
+            cur.tag |= HotNode::closedBit;
+            closed.push_back(index);
+            for(int i = 0; i < count; i++){
+                int nx = x+neighour[i][1], ny = y+neighour[i][0];
+                if(!ctx.inWindow(nx, ny) || isBlocked(nx, ny)) continue;
+                size_t nindex = ny*width+nx;
+                auto& nd = ctx.touchNode(nindex);
+                float newCost = cur.cost + cost(nindex) * (1.f + static_cast<int>(i/4)*0.414f);
+                if(newCost < nd.cost){
+                    nd.cost = newCost;
+                    ctx.parentMap.data[nindex] = index;
+                    if(nd.closed()){
+                        incons.push_back(nindex);
+                    }else{
+                        openList.pushOrUpdate(nindex, keyOf(nindex));
+                    }
+                }
+            }
+        }
+        if(timeout || !(ctx.hotMap.data[endIndex].cost < std::numeric_limits<float>::infinity())){
+            break;// 超时，或者开集已空仍未到达终点（无解）
+        }
+        // 发布当前权重下的路径
+        best.clear();
+        for(long index = endIndex; index != -1; index = ctx.parentMap.data[index]){
+            best.push_back(std::make_pair(index%width*mapping, index/width*mapping));
+        }
+        std::reverse(best.begin(), best.end());
+        if(achievedWeight) *achievedWeight = estimWeight;
+        if(estimWeight <= 1.f || secondsSince(t0) >= budgetSeconds){
+            break;
+        }
+        // 降低权重：不一致节点放回开集，按新权重重建开集，清空闭集
+        estimWeight = std::max(1.f, estimWeight - weightStep);
+        for(size_t index : incons){
+            if(!openList.contains(index)) openList.push(index, 0.f);
+        }
+        incons.clear();
+        for(size_t index : closed){
+            ctx.hotMap.data[index].tag &= ~HotNode::closedBit;
+        }
+        closed.clear();
+        openList.rekey(keyOf);
+    }
+    return best;
+}
+
+////////////////////////////// StepSearch //////////////////////////////
+
+AStar::StepSearch::StepSearch(const AStar& _astar): astar(_astar), openList(NodeHeapPos{&ctx.heapPosMap}) {}
+
+void AStar::StepSearch::start(std::pair<float, float> start, std::pair<float, float> end){
+    int width = astar.originMap.shape(1), height = astar.originMap.shape(0);
+    // 先清开集：它按旧地图尺寸把位置句柄写回ctx，必须在resize之前
+    openList.clear();// 只把开集中元素的位置句柄置为-1，保留容量
+    if(ctx.hotMap.data == nullptr || ctx.hotMap.shape(0) != height || ctx.hotMap.shape(1) != width){
+        ctx.resize(width, height);
+    }
+    ctx.reset();
+    result.clear();
+    startx = start.first/astar.mapping;
+    starty = start.second/astar.mapping;
+    endx = end.first/astar.mapping;
+    endy = end.second/astar.mapping;
+    size_t startIndex = static_cast<size_t>(starty)*width+startx;
+    ctx.touchNode(startIndex).cost = 0;
+    ctx.parentMap.data[startIndex] = -1;
+    startDistance2 = bestDistance2 = static_cast<long long>(startx-endx)*(startx-endx) + static_cast<long long>(starty-endy)*(starty-endy);
+    openList.push(startIndex, astar.heuristic == HeuristicPolicy::Octile ? OctileHeuristic::exact(startx-endx, starty-endy) : EuclideanHeuristic::exact(startx-endx, starty-endy));
+    expandedCount = 0;
+    state = astar.maybeConnected(startIndex, static_cast<size_t>(endy)*width+endx) ? Status::Running : Status::NoPath;
+}
+
+void AStar::StepSearch::cancel(){
+    if(state == Status::Running){
+        state = Status::Cancelled;
+    }
+}
+
+float AStar::StepSearch::progress() const {
+    if(state == Status::Found) return 1.f;
+    return startDistance2 > 0 ? 1.f - std::sqrt(static_cast<float>(bestDistance2) / startDistance2) : 0.f;
+}
+
+AStar::StepSearch::Status AStar::StepSearch::step(int maxExpansions){
+    if(state != Status::Running) return state;
+    auto withCost = [&](const auto& cost){
+        if(astar.heuristic == HeuristicPolicy::Octile){
+            return stepWith<OctileHeuristic>(cost, maxExpansions);
+        }
+        return stepWith<EuclideanHeuristic>(cost, maxExpansions);
+    };
+    if(astar.costStorage == CostStorage::Quant8 && astar.costMap8.data != nullptr){
+        return withCost(Quant8Cost{astar.costMap8.data, astar.quant8Step});
+    }
+    if(astar.costStorage == CostStorage::BFloat16 && astar.costMap16.data != nullptr){
+        return withCost(BFloat16Cost{astar.costMap16.data});
+    }
+    return withCost(FloatCost{astar.costMap.data});
+}
+
+template<typename Heuristic, typename Cost>
+AStar::StepSearch::Status AStar::StepSearch::stepWith(const Cost& cost, int maxExpansions){
+    int width = ctx.hotMap.shape(1);
+    const int count = std::clamp(astar.neighourCount, 4, 8);
+    for(int n = 0; n < maxExpansions; n++){
+        if(openList.empty()){
+            state = Status::NoPath;
+            return state;
+        }
+        size_t index = openList.pop();
+        expandedCount++;
+        int y = index/width, x = index%width;
+        if(x==endx && y==endy){
+            for(long p = index; p != -1; p = ctx.parentMap.data[p]){
+                result.push_back(std::make_pair(p%width*astar.mapping, p/width*astar.mapping));
+            }
+            std::reverse(result.begin(), result.end());
+            state = Status::Found;
+            return state;
+        }
+        HotNode& cur = ctx.hotMap.data[index];
+        cur.tag |= HotNode::closedBit;
+        bestDistance2 = std::min(bestDistance2, static_cast<long long>(x-endx)*(x-endx) + static_cast<long long>(y-endy)*(y-endy));
+        for(int i = 0; i < count; i++){
+            int nx = x+neighour[i][1], ny = y+neighour[i][0];
+            if(!ctx.inWindow(nx, ny) || astar.isBlocked(nx, ny)) continue;
+            size_t nindex = ny*width+nx;
+            auto& nd = ctx.touchNode(nindex);
+            if(nd.closed()) continue;
+            float newCost = cur.cost + cost(nindex) * (1.f + static_cast<int>(i/4)*0.414f);
+            if(newCost < nd.cost){
+                nd.cost = newCost;
+                ctx.parentMap.data[nindex] = index;
+                openList.pushOrUpdate(nindex, newCost + Heuristic::distance(nx - endx, ny - endy));
+            }
+        }
+    }
+    return state;
+}
+
 void AStar::reset(){
-    Node zeroNode;
-    std::fill(nodeMap.data, nodeMap.data+nodeMap.size(), zeroNode);
-    reseted = true;
+    context.reset();
+}
+
+void AStar::SearchContext::reset(){
+    generation = (generation + 1) & HotNode::generationMask;
+    touched = 0;
+    if(generation == 0){
+        // 代次回绕，此时才真正清空一次整张地图
+        hotMap.fill(HotNode{std::numeric_limits<float>::infinity(), 0});
+        heapPosMap.fill(-1);
+    }
+}
+
+void AStar::SearchContext::resize(int width, int height){
+    if(hotMap.data == nullptr || hotMap.shape(0) != height || hotMap.shape(1) != width){
+        hotMap = YTensor<HotNode,2>(height, width);
+        heapPosMap = YTensor<int,2>(height, width);
+        parentMap = YTensor<int,2>(height, width);
+        generation = 0;
+        hotMap.fill(HotNode{std::numeric_limits<float>::infinity(), 0});// 新建的节点代次都为0
+        heapPosMap.fill(-1);
+    }
+    windowX0 = 0;
+    windowY0 = 0;
+    windowX1 = width;
+    windowY1 = height;
 }
@@ -2,16 +2,61 @@
 #define YASTAR_HPP
 
 #include <vector>
-#include <queue>
 #include <unordered_map>
+#include <list>
 #include <functional>
+#include <memory>
+#include <cstdint>
+#include <string>
 #include "ytensor.hpp"
+#include "yqueue.hpp"
 
+// 搜索统计开关，定义为0时统计代码在编译期完全去掉（SearchStats保持全0）
+#ifndef YASTAR_STATS
+#define YASTAR_STATS 1
+#endif
 
 
 // @brief 旨在使用空间换速度的A*算法实现 
 class AStar {
 public:
+    // 启发函数
+    enum class HeuristicPolicy{
+        Euclidean, // 欧氏距离（默认）
+        Octile     // 8邻居对角距离，max + 0.414*min，8邻居传统A*时比欧氏距离更紧
+    };
+
+    // 搜索时读取的代价地图存储格式
+    enum class CostStorage{
+        Float32,  // 直接读float代价地图（默认）
+        Quant8,   // 8位量化：代价 = 编码 * 量化步长，255为不可通行
+        BFloat16  // 16位浮点（float的高16位，向上取整），无穷为不可通行
+    };
+
+    // 开集队列策略
+    enum class QueuePolicy{
+        BinaryHeap, // 4叉堆，精确
+        Bucket      // 单调桶队列，O(1)，有量化误差
+    };
+
+    // 像素矩形
+    struct Region{
+        int x, y, w, h;
+    };
+
+    // @brief 单次搜索的统计，计数在搜索循环里只是局部变量自增，搜索结束后才写出
+    struct SearchStats{
+        size_t expanded = 0;   // 弹出并扩展的节点数
+        size_t pushes = 0;     // 压入或更新开集的次数
+        size_t stalePops = 0;  // 弹出时跳过的过期条目数（只有桶队列会产生）
+        size_t peakOpen = 0;   // 开集的最大大小
+        size_t touched = 0;    // 本次搜索访问到的格子数
+        double resetSeconds = 0.;       // 准备上下文（推进代次，必要时分配节点表）的耗时
+        double searchSeconds = 0.;      // 搜索主循环的耗时（不含路径回溯）
+        double reconstructSeconds = 0.; // 回溯路径的耗时
+        bool found = false;    // 是否找到路径
+    };
+
     AStar() = default;
     AStar(int width, int height, u_char* mapData);
     
@@ -21,18 +66,37 @@ public:
     // 设置地图
     void setMap(int width, int height, u_char *mapData);
 
+    // @brief 借用外部的地图缓冲区（比如共享内存），不复制。
+    // 缓冲区需要在AStar使用期间一直有效，updateRegion会直接写入它；之后调用setMap会换回自己拥有的副本
+    void setMapView(int width, int height, u_char *mapData);
+
     // 设置代价地图，weight 为代价权重，默认为1
     void setCostMap(int width, int height, float* _costmapData, float weight=1.0f);
 
+    // @brief 借用外部的float代价地图缓冲区，不复制（相当于weight为1的setCostMap，无穷为不可通行）。
+    // 缓冲区需要在AStar使用期间一直有效；硬膨胀和updateRegion会直接写入它，外部修改后需要调用updateRegion或重新调用本函数
+    void setCostMapView(int width, int height, float* _costmapData);
+
     // 设置代价地图
     void setCostMap(int width, int height, u_char *_costmapData, float weight=1.0f);
 
-    // 获取代价地图数据，不可以保存为图片
+    // 获取代价地图数据，不可以保存为图片。返回视图（不复制），在代价地图重新生成前有效，需要副本时调用clone()
     YTensor<float,2> getCostMap();
 
-    // 获取代价地图，可以保存为图片
+    // 获取代价地图，可以保存为图片。Quant8模式下直接返回量化代价地图的视图（不复制，像素值*量化步长为代价，255为不可通行），在代价地图重新生成前有效
     YTensor<u_char,2> getCostMapImage();
 
+    // @brief 设置搜索使用的代价地图存储格式，紧凑格式每个格子只读1~2字节，相同缓存能放下更大的地图。
+    // float代价地图仍然保留（用于生成、局部更新和分层/增量搜索），紧凑副本在代价地图每次改变后同步生成。
+    // 量化时向上取整，启发函数保持可采纳
+    // @param _storage 存储格式
+    // @param _quantum Quant8的量化步长，<=0表示自动。整数代价地图（setCostMap(u_char*)）的0格存为0.1*权重：
+    // 最大代价不超过25.4*权重时用0.1*权重（无损），否则用权重（只有0格有损，读出为1*权重）；其余情况为最大有限代价/254
+    void setCostStorage(CostStorage _storage, float _quantum = 0.f);
+
+    // 搜索实际使用的格子代价（按当前存储格式解码），不可通行为无穷
+    float cellCost(int x, int y) const;
+
     // 设置行走步长,需要小于Speed的值
     void setStride(float _strideMeter);
 
@@ -45,25 +109,137 @@ public:
     // 设置是否采用传统A*算法，默认为false。传统A*算法至少需要4个邻居节点。
     void setTraditional(bool _traditional);
 
+    // @brief 设置开集的队列策略
+    // @param _policy BinaryHeap（默认）或Bucket。Bucket只在代价地图来自setCostMap(u_char*)（整数代价乘权重）时生效，其余情况自动退回BinaryHeap
+    // @param _bucketWidth 桶宽，<=0表示使用代价地图的量化步长（即weight）。
+    // 误差界：Bucket模式下允许重新打开闭集节点，传统A*且启发函数可采纳时，返回路径的代价不超过 最优代价 + 桶宽
+    void setQueuePolicy(QueuePolicy _policy, float _bucketWidth = 0.f);
+
+    // @brief 设置启发函数，两种启发函数在代价地图最小代价不小于1时都是可采纳的
+    void setHeuristic(HeuristicPolicy _heuristic);
+
+    // @brief 设置是否启用跳点搜索(JPS+)，只在传统A*且8邻居时生效。
+    // 代价均匀（等于地图最小代价）的区域按预计算的跳跃距离扩展，膨胀区域（代价不均匀）退回逐格扩展。
+    void setJumpPointSearch(bool _jumpPointSearch);
+
     // @brief 初始化代价地图
     // @param _costWeight 代价权重
     // @param _funcInflateRadius 障碍物函数影响半径（米）
     // @param _decayFunction 代价衰减函数，传入最近障碍物的距离（米），返回代价。函数不需要考虑代价权重
     void initCostMap(float _costWeight = 1.0f, float _funcInflateRadius = 1.f, std::function<float(float)> _decayFunction = [](float x){ return 1 / x; });
 
-    // @brief SIMD初始化代价地图(avx2)
+    // @brief SIMD初始化代价地图，运行时按CPU选择AVX-512/AVX2/标量内核，结果与initCostMap一致
     // @param _costWeight 代价权重
     // @param _funcInflateRange 障碍物函数影响边长（方形，像素，需要8的倍数）
     // @param _decayFunction 代价衰减函数，传入最近障碍物的距离（米），返回代价。函数不需要考虑代价权重
     void initCostMapFast(float _costWeight = 1.0f, float _funcInflateRadius = 1.f, std::function<float(float)> _decayFunction = [](float x){ return 1 / x; });
 
+    // @brief 用精确欧氏距离变换初始化代价地图，O(W*H)，耗时与膨胀半径无关
+    // 行列可分离的Felzenszwalb-Huttenlocher距离变换求出每个格子到最近障碍物的距离，再查衰减函数的预计算表得到代价。
+    // 影响范围是半径内的圆（initCostMap为方形窗口），其余语义与initCostMap相同。
+    // @param _costWeight 代价权重
+    // @param _funcInflateRadius 障碍物函数影响半径（米）
+    // @param _decayFunction 代价衰减函数，传入最近障碍物的距离（米），返回代价。函数不需要考虑代价权重
+    void initCostMapEDT(float _costWeight = 1.0f, float _funcInflateRadius = 1.f, std::function<float(float)> _decayFunction = [](float x){ return 1 / x; });
+
+    // @brief 设置硬膨胀半径，与障碍物距离（欧氏）不超过该半径的格子不可通行。
+    // 在障碍物位图上做按字并行的圆形膨胀，之后生成/更新的代价地图都会应用；当前已有代价地图时立即应用（半径变小时需要重新生成代价地图）
+    // @param _radiusMeter 半径（米），<=0表示不做硬膨胀
+    void setHardInflation(float _radiusMeter);
+
+    // @brief 局部更新地图，只在更新矩形向外扩膨胀半径的范围内重算代价地图（障碍物的增加和移除都正确处理）
+    // 代价地图来自initCostMap*时，按最近一次的参数重算窗口。
+    // 代价地图来自setCostMap/setCostMapView时没有膨胀信息，不会重算：只改障碍物状态翻转的格子（变为障碍物时置为不可通行，
+    // 恢复可通行时还原之前的代价），其余格子（包括代价地图里原本不可通行的格子）保持不变，再叠加硬膨胀。
+    // 还没有代价地图时只更新地图本身。
+    // @param x,y,w,h 更新的矩形（像素）
+    // @param patch 新的地图数据，w*h，行优先，语义与setMap相同（0为障碍物）
+    // @return 代价地图中实际改变的矩形（已裁剪到地图内），可以交给AStarHierarchy::update等；没有代价地图时为空
+    Region updateRegion(int x, int y, int w, int h, u_char* patch);
+
+    class SearchContext;
+    class StepSearch;
+
     // @brief 搜索路径
     // @param start 起点
     // @param end 终点
+    // @param stats 可选的统计输出，为空时不计时
+    // @return 路径 （返回空数组表示无解）
+    std::vector<std::pair<float, float>> search(std::pair<float, float> start, std::pair<float, float> end, SearchStats* stats = nullptr);
+
+    // @brief 使用外部的搜索上下文搜索路径，不修改AStar本身，不同线程使用各自的上下文即可并发调用
+    // 需要先调用一次prepare()（search(start, end)和searchBatch会自动调用），否则跳点表过期时不使用跳点搜索
+    // @param context 搜索上下文
+    // @param start 起点
+    // @param end 终点
+    // @param stats 可选的统计输出，为空时不计时
     // @return 路径 （返回空数组表示无解）
-    std::vector<std::pair<float, float>> search(std::pair<float, float> start, std::pair<float, float> end);
+    std::vector<std::pair<float, float>> search(SearchContext& context, std::pair<float, float> start, std::pair<float, float> end, SearchStats* stats = nullptr) const;
+
+    // @brief 限时的可中断搜索(ARA*)：先用放大的启发权重快速得到次优路径，时间允许时逐步降低权重改进路径，
+    // 各轮之间复用开集、闭集和代价，不从头搜索。按传统A*的邻域扩展（不考虑动量，不使用跳点搜索）
+    // @param start 起点
+    // @param end 终点
+    // @param budgetSeconds 时间预算（秒），到时返回已找到的最好路径
+    // @param initialWeight 初始启发权重，路径代价不超过最优代价的该倍数
+    // @param weightStep 每轮降低的权重，降到1时得到最优路径并结束
+    // @param achievedWeight 可选输出，返回路径对应的权重（次优界），未找到路径时为0
+    // @return 路径 （预算内没有找到路径或无解时返回空数组）
+    std::vector<std::pair<float, float>> searchWithDeadline(std::pair<float, float> start, std::pair<float, float> end, float budgetSeconds, float initialWeight = 3.f, float weightStep = 0.5f, float* achievedWeight = nullptr);
+
+    // @brief 用到终点的距离场求路径：缓存里没有该终点的距离场时先做一次反向Dijkstra，之后沿距离场下降，O(路径长度)，不需要搜索（代价为0的平台上改为在平台内广度优先）。
+    // 适合很多起点去同一个终点（比如充电桩）。按传统A*的邻域，读float代价地图，地图或代价地图改变后缓存自动失效
+    // @param start 起点
+    // @param end 终点
+    // @return 最优路径 （返回空数组表示无解）
+    std::vector<std::pair<float, float>> searchByField(std::pair<float, float> start, std::pair<float, float> end);
+
+    // @brief 预先计算并缓存到各终点的距离场，多个终点并行计算
+    void precomputeFields(const std::vector<std::pair<float, float>>& goals);
+
+    // @brief 设置距离场缓存的内存上限（字节，默认256MB），超出时淘汰最久没有使用的距离场
+    void setFieldCacheBudget(size_t bytes);
+
+    // 清空距离场缓存
+    void clearFieldCache();
+
+    // @brief 多目标搜索，一次扩展找到代价最小的目标。启发函数取到各目标距离的最小值，仍然可采纳且一致。
+    // 按传统A*的邻域扩展（不考虑动量，不使用跳点搜索）
+    // @param start 起点
+    // @param goals 候选终点
+    // @param goalIndex 可选输出，到达的目标在goals中的下标，无解时为-1
+    // @return 到最近目标的路径 （返回空数组表示所有目标都无解）
+    std::vector<std::pair<float, float>> search(std::pair<float, float> start, const std::vector<std::pair<float, float>>& goals, int* goalIndex = nullptr);
 
-    // 重置地图，每次搜索前都需要调用一次，不过其实search函数里面有检查的，会自动重置。
+    // @brief 多目标搜索，一次扩展求出到所有目标的最小代价，所有可达目标都关闭后结束
+    // @param start 起点
+    // @param goals 终点
+    // @return 与goals一一对应的最小代价（代价地图值按步长累加，对角步乘1.414），不可达为无穷
+    std::vector<float> searchCosts(std::pair<float, float> start, const std::vector<std::pair<float, float>>& goals);
+
+    // @brief 并行批量搜索，所有线程共享同一份代价地图，每个工作者一个SearchContext（批次之间复用），查询按原子下标动态领取
+    // @param queries 起点、终点对
+    // @param threadCount 线程数，<=0表示硬件线程数
+    // @param stats 可选的统计输出，会被调整为与queries一一对应
+    // @return 与queries一一对应的路径
+    std::vector<std::vector<std::pair<float, float>>> searchBatch(const std::vector<std::pair<std::pair<float, float>, std::pair<float, float>>>& queries, int threadCount = 0, std::vector<SearchStats>* stats = nullptr);
+
+    // 准备搜索需要的预计算数据（比如跳点表），之后地图数据在搜索期间只读
+    void prepare();
+
+    // @brief 保存预处理后的规划器状态快照（地图、代价地图、紧凑代价地图、位图、跳点表和各项设置），二进制带版本号
+    // 各数组按64字节对齐存放，loadSnapshot可以直接映射使用
+    // @param path 文件路径
+    // @return 是否成功
+    bool saveSnapshot(const std::string& path) const;
+
+    // @brief 用mmap载入saveSnapshot保存的快照，地图张量直接是映射内存的视图（私有映射，写入时按页复制，不影响文件），不需要重新生成代价地图
+    // 可以在默认构造的AStar上调用。映射在下一次载入快照或AStar析构前一直有效
+    // @param path 文件路径
+    // @return 是否成功，文件不存在、版本或格式不匹配时返回false，原状态不变
+    bool loadSnapshot(const std::string& path);
+
+    // 重置地图。内部只是推进一次代次(generation)，不会清空整张节点表，search函数开始时会自动调用。
     void reset();
 
     // @brief 压缩路径，将路径中的冗余点删除。
@@ -84,52 +260,315 @@ public:
     // @return 路径长度
     float getLength(std::vector<std::pair<float, float>>& _path)const;
 protected:
-    // 节点结构体
-    struct Node{
-        float cost, estim; // 到节点前的代价，到终点的启发代价
-        int parent;        // 父节点索引
-        float speedx, speedy; // 速度（*就是每一步的速度偏移量，按照像素计算*）  不需要添加angle，因为都是两次求解，没必要浪费空间。
-        bool closed;// 是不是闭集
-        inline float getCostTotal() { return cost + estim; }// 我有一个主意，把speedx和speedy也加入到代价中，因为实际情况是我希望车车越快越好。
-        explicit Node(float _cost = std::numeric_limits<float>::infinity(), float _estim = std::numeric_limits<float>::infinity(), int _parent = -1, float _speedx = 0, float _speedy = 0):
-            cost(_cost), estim(_estim), parent(_parent), speedx(_speedx), speedy(_speedy),closed(false) {}
-        Node& operator=(const Node& other){
-            cost = other.cost;
-            estim = other.estim;
-            parent = other.parent;
-            speedx = other.speedx;
-            speedy = other.speedy;
-            closed = other.closed;
-            return *this;
+    friend class AStarHierarchy;
+    friend class DStarLite;
+
+    // @brief 节点的热数据，扩展邻居时每个格子都要读，所以只留代价和标记（8字节）
+    // 父节点、开集位置、速度放在单独的数组里，只在代价被更新时才写；启发代价不存储，入堆时现算
+    struct HotNode{
+        float cost;        // 到节点前的代价
+        unsigned int tag;  // 低30位为节点所属的代次，与当前代次不同则视为无穷代价、未关闭；最高位为闭集标记，次高位见pixelBit
+        static constexpr unsigned int closedBit = 0x80000000u;
+        static constexpr unsigned int pixelBit = 0x40000000u;// 最后一次由逐格分支更新（启发代价按像素计），否则由动量分支更新（按米计）
+        static constexpr unsigned int generationMask = 0x3FFFFFFFu;
+        inline bool closed() const { return tag & closedBit; }
+    };
+
+public:
+    // @brief 单次搜索的临时状态（节点表、代次、搜索窗口）。
+    // 地图数据（originMap、costMap、各项设置）在搜索时只读，每个线程使用自己的SearchContext即可并发搜索。
+    class SearchContext{
+    public:
+        // 推进代次，不会清空整张节点表
+        void reset();
+    protected:
+        friend class AStar;
+        friend class AStar::StepSearch;
+        friend class AStarHierarchy;
+
+        // 按地图大小准备节点表，大小变化时重新分配，并把搜索窗口设为整张地图
+        void resize(int width, int height);
+
+        // 取出当前代次下的节点，过期的节点会被就地重置（惰性清空）
+        inline HotNode& touchNode(size_t index){
+            HotNode& nd = hotMap.data[index];
+            if((nd.tag & HotNode::generationMask) != generation){
+                nd.cost = std::numeric_limits<float>::infinity();
+                nd.tag = generation;
+                heapPosMap.data[index] = -1;
+#if YASTAR_STATS
+                touched++;
+#endif
+            }
+            return nd;
+        }
+
+        // 是否在搜索窗口内
+        inline bool inWindow(int x, int y) const {
+            return x>=windowX0 && x<windowX1 && y>=windowY0 && y<windowY1;
         }
+
+        YTensor<HotNode,2> hotMap;// 代价和闭集标记
+        YTensor<int,2> heapPosMap;// 在开集堆中的位置（桶队列时为桶号），-1表示不在开集中
+        YTensor<int,2> parentMap;// 父节点索引
+        YTensor<int,2> motionMap;// 速度状态编号（见motionSpeeds），只有考虑动量时才分配
+        unsigned int generation = 0;// 当前搜索代次（30位），tag中的代次不等于它的节点都视为未访问
+        int windowX0 = 0, windowY0 = 0, windowX1 = 0, windowY1 = 0;// 搜索窗口[x0, x1) x [y0, y1)，默认为整张地图，分层搜索细化时限制在簇内
+        SearchStats* stats = nullptr;// 当前搜索的统计输出，由search设置
+        bool quiet = false;// 无解时不打印（内部的试探性搜索，比如分层搜索在簇内细化，失败后还会放宽窗口）
+        bool traditional8 = false;// 忽略traditional和neighourCount，固定按传统8邻居搜索（分层搜索细化时与抽象图的代价模型一致）
+        size_t touched = 0;// 本代次访问到的格子数，reset时清零
     };
+protected:
 
-    // 比较节点的优先级（cost total）
+    // 比较节点的优先级（cost total），直接比较堆里缓存的f值，不再回查节点表
     struct CompareNode{
-        const YTensor<Node,2> &cpMap;
         // const float estimWeight;// 预计代价权重
+        inline bool operator()(float costTotal, float costTotal2) const {
+            return costTotal < costTotal2;
+        }
+    };
 
-        CompareNode(const YTensor<Node,2>& _cpMap, std::_Placeholder<1> _= std::placeholders::_1):
-        cpMap(_cpMap)
-        {}
-
-        bool operator()(size_t& index, size_t& index2){
-            return cpMap.data[index].getCostTotal() > cpMap.data[index2].getCostTotal();
+    // 开集的位置句柄（堆中位置或桶号），存放在上下文的heapPosMap里
+    struct NodeHeapPos{
+        YTensor<int,2>* cpMap;
+        inline int& operator()(size_t index) const {
+            return cpMap->data[index];
         }
     };
+    // 跳点表的格子，dist[i]对应邻居方向i：正数为到下一个跳点的步数，非正数为到障碍物前可走步数的相反数
+    struct JumpCell{
+        enum : u_char { Wall = 0, Uniform = 1, Weighted = 2, Border = 3 };// Border为紧邻膨胀区域的均匀格子，视为全方向跳点
+        short dist[8];
+        u_char type;
+    };
+
+    // @brief 衰减函数查找表，下标为到障碍物距离的平方（像素^2），范围[0, r^2]
+    std::vector<float> buildDecayTable(int r, float _costWeight, const std::function<float(float)>& _decayFunction) const;
+
+    // @brief 在窗口内做欧氏距离变换，并按查找表写入代价地图
+    // 窗口[x0, x1) x [y0, y1)内的障碍物参与计算，只写入其中的[ox0, ox1) x [oy0, oy1)
+    void inflateEDT(int x0, int y0, int x1, int y1, int ox0, int oy0, int ox1, int oy1, const std::vector<float>& decayTable, float _costWeight);
+
+    // 最近一次生成代价地图的方式，updateRegion按它局部重算
+    enum class InflateMode{
+        None,   // 来自setCostMap，没有膨胀信息
+        Square, // initCostMap/initCostMapFast，方形窗口
+        Disk    // initCostMapEDT，圆形范围
+    };
+
+    // 记录方形膨胀的参数，mask会按权重从大到小排序
+    void rememberSquareInflation(int r, float _costWeight, std::vector<std::pair<std::pair<int,int>,std::pair<int,float>>>& biasMask);
+
+    // @brief 按inflateMask计算窗口[x0, x1) x [y0, y1)内的方形膨胀代价（yAstarSimd.cpp）
+    // 每个像素取第一个（权重最大的）碰到障碍物的mask权重，按行并行，行内用向量指令一次处理8/16个像素
+    void inflateSquare(int x0, int y0, int x1, int y1);
+
+    // 根据当前代价地图预计算跳点表
+    void buildJumpMap();
+
+    // @brief 预计算动量模式的运动基元表，setMapping/setStride/setNeighourCount/setSpeed后自动调用
+    // 速度分量被限制在[-S, S]（S为映射后的最大速度）内且只会是整数或±S，所以速度状态是有限的，
+    // 每个状态下各邻居方向的偏移只需要用三角函数算一次
+    void buildMotionTable();
+
+    // 整数位移对应的速度分量下标（位移先被限制在[-S, S]内）
+    inline int speedIndex(int d) const {
+        return std::clamp(d, -motionHalf, motionHalf) + motionHalf;
+    }
+
+    // 地图（originMap）整体改变后调用，重建节点表和位图
+    void onMapChanged();
+
+    // 代价地图改变后调用：应用硬膨胀，更新不可通行位图，使依赖代价地图的预计算数据失效
+    void onCostMapChanged();
+    // 同上，只处理窗口[x0, x1) x [y0, y1)
+    void onCostMapChanged(int x0, int y0, int x1, int y1);
+
+    // 按originMap重建[y0, y1)行的障碍物位图（yAstarSimd.cpp）
+    void packOccupancy(int y0, int y1);
+
+    // 按代价地图重建[y0, y1)行的不可通行位图（yAstarSimd.cpp）
+    void packBlocked(int y0, int y1);
+
+    // @brief 把窗口[x0, x1) x [y0, y1)内与障碍物距离不超过hardInflateRadius的格子代价设为无穷（yAstarSimd.cpp）
+    // 对障碍物位图逐行做水平膨胀（移位或，按倍增步长）再按圆的各行宽度合并
+    void applyHardInflation(int x0, int y0, int x1, int y1);
+
+    // @brief 代价地图没有膨胀信息（来自setCostMap）时的硬膨胀：先还原窗口内叠加过、现在不是障碍物的格子，
+    // 再做硬膨胀，并把新改为无穷的格子的原代价记在overlaidCost里，这样障碍物移除后可以还原
+    void overlayHardInflation(int x0, int y0, int x1, int y1);
+
+    // @brief 按不可通行位图重建8连通分量（yAstarComponents.cpp）
+    // 按行分条并行做并查集，再串行合并条带边界，最后并行压平为根节点编号
+    void buildComponents();
+
+    // @brief 窗口[x0, x1) x [y0, y1)内的格子改变后更新连通分量：只有格子变为可通行时增量合并，有格子变为不可通行（可能分裂）时标记过期，prepare时整体重建
+    void updateComponents(int x0, int y0, int x1, int y1);
+
+    // @brief 两个格子是否可能连通（传统A*的邻域都是8邻域的子集，不连通就一定无解）。分量过期时总是返回true
+    bool maybeConnected(size_t from, size_t to) const;
+
+    // 缓存的距离场，dist为每个格子到goal的最小代价
+    struct DistanceField{
+        size_t goal;       // 终点的格子编号
+        int neighbours;    // 计算时的邻居数
+        YTensor<float,2> dist;
+    };
+
+    // @brief 反向Dijkstra计算到goal的距离场（yAstarField.cpp），只读地图
+    void computeField(size_t goal, int neighbours, YTensor<float,2>& dist) const;
+
+    // 取出（必要时计算）到goal的距离场，并移到LRU的最前面
+    const DistanceField& fieldFor(size_t goal);
+
+    // @brief 沿距离场下降遇到代价为0、距离相同的平台时，在平台内广度优先找终点或代价最小的出口，路径追加到path
+    // @param x,y 输入平台上的当前格子，输出为终点或平台外的出口格子
+    // @return 平台上既没有终点也没有出口时返回false
+    bool walkPlateau(const DistanceField& field, int& x, int& y, int endx, int endy, std::vector<std::pair<float, float>>& path) const;
+
+    // 按预算淘汰LRU末尾的距离场，至少保留最新的一个
+    void trimFieldCache();
+
+    // 格子是否不可通行，只读1位
+    inline bool isBlocked(int x, int y) const {
+        return (blockedMap.data[static_cast<size_t>(y)*blockedMap.shape(1) + (x>>6)] >> (x&63)) & 1u;
+    }
+
+    using OpenList = IndexedHeap<float, NodeHeapPos, CompareNode, 4>;
+    using BucketOpenList = BucketQueue<NodeHeapPos>;
+
+    // 邻域策略：正数为传统A*的固定邻居数，下面两个值为特殊的邻域
+    static constexpr int RuntimeNeighbours = 0;   // 传统A*，邻居数在运行时读取（5~7个邻居）
+    static constexpr int MomentumNeighbours = -1; // 考虑动量的运动基元，临近终点时退回运行时邻居数的逐格扩展
+
+    // @brief 按策略特化的搜索主循环，由search在开始时选择一次，循环内没有策略相关的分支
+    // @tparam Queue 开集类型
+    // @tparam Heuristic 启发函数策略，见yAstar.cpp
+    // @tparam Neighbours 邻域策略
+    // @tparam Cost 代价读取策略（按存储格式解码），见yAstar.cpp
+    template<typename Queue, typename Heuristic, int Neighbours, typename Cost>
+    std::vector<std::pair<float, float>> searchWith(SearchContext& ctx, Queue& openList, const Cost& cost, std::pair<float, float> start, std::pair<float, float> end) const;
+
+    // 按邻域策略选择特化的搜索主循环
+    template<typename Queue, typename Heuristic, typename Cost>
+    std::vector<std::pair<float, float>> dispatchNeighbours(SearchContext& ctx, Queue& openList, const Cost& cost, std::pair<float, float> start, std::pair<float, float> end) const;
+
+    // 按启发函数策略选择特化的搜索主循环
+    template<typename Queue, typename Cost>
+    std::vector<std::pair<float, float>> dispatchHeuristic(SearchContext& ctx, Queue& openList, const Cost& cost, std::pair<float, float> start, std::pair<float, float> end) const;
+
+    // 按代价地图存储格式选择特化的搜索主循环
+    template<typename Queue>
+    std::vector<std::pair<float, float>> dispatchCost(SearchContext& ctx, Queue& openList, std::pair<float, float> start, std::pair<float, float> end) const;
+
+    // @brief 多目标搜索主循环，见search(start, goals)和searchCosts
+    // @param all 为true时求出所有目标的代价（写入costs），否则到达第一个目标就返回路径
+    template<typename Heuristic, typename Cost>
+    std::vector<std::pair<float, float>> multiGoalWith(SearchContext& ctx, const Cost& cost, std::pair<float, float> start, const std::vector<std::pair<float, float>>& goals, bool all, int* goalIndex, std::vector<float>* costs) const;
+
+    // @brief ARA*主循环，见searchWithDeadline
+    // @tparam Heuristic 启发函数策略
+    // @tparam Cost 代价读取策略
+    template<typename Heuristic, typename Cost>
+    std::vector<std::pair<float, float>> anytimeWith(SearchContext& ctx, const Cost& cost, std::pair<float, float> start, std::pair<float, float> end, float budgetSeconds, float initialWeight, float weightStep, float* achievedWeight) const;
+
+    // 按float代价地图生成窗口[x0, x1) x [y0, y1)内的紧凑代价地图
+    void packCompactCost(int x0, int y0, int x1, int y1);
 
     YTensor<u_char,2> originMap;
     YTensor<float,2> costMap;
-    YTensor<Node,2> nodeMap;
+    YTensor<uint8_t,2> costMap8;// Quant8格式的代价地图
+    YTensor<uint16_t,2> costMap16;// BFloat16格式的代价地图
+    CostStorage costStorage = CostStorage::Float32;// 搜索使用的代价地图存储格式
+    float storageQuantum = 0.f;// 用户设置的Quant8量化步长，<=0表示自动
+    float quant8Step = 1.f;// Quant8实际使用的量化步长
+    YTensor<uint64_t,2> occupancyMap;// 障碍物位图，每行按64位打包，1为障碍物（originMap为0）
+    YTensor<uint64_t,2> blockedMap;// 不可通行位图（代价为无穷），每行按64位打包，搜索时用它判断能不能走
+    int hardInflateRadius = 0;// 硬膨胀半径（像素），0表示不做
+    SearchContext context;// search(start, end)使用的默认上下文
+    std::vector<std::unique_ptr<SearchContext>> batchContexts;// searchBatch的每工作者上下文，批次之间复用
+    YTensor<JumpCell,2> jumpMap;// 跳点表(JPS+)
     float mapping;// 映射比例，每个像素代表多少米
     float stride;// 行走步长(米)
     float speed;// 行走速度(米/秒)
     int neighourCount; // 邻居节点个数
-    // float estimWeight;// 预计代价权重
+    int motionHalf;// 速度分量下标的中心，速度分量共有2*motionHalf+1种取值
+    std::vector<float> motionSpeeds;// 速度分量的取值（像素），状态编号为 iy*(2*motionHalf+1)+ix
+    std::vector<std::pair<float,float>> motionOffsets;// [状态*neighourCount+i]，速度方向旋转后第i个邻居相对于速度终点的偏移（像素）
     float costWeight;// 代价权重
-    bool reseted;// 是否重置过
     bool traditional;// 是否使用传统A*算法
-    
+    HeuristicPolicy heuristic = HeuristicPolicy::Euclidean;// 启发函数
+    QueuePolicy queuePolicy = QueuePolicy::BinaryHeap;// 开集队列策略
+    float bucketWidth = 0.f;// 桶队列的桶宽，<=0表示使用costQuantum
+    float costQuantum = 0.f;// 代价地图的量化步长，0表示代价为任意浮点数
+    bool jumpPointSearch = false;// 是否启用跳点搜索
+    bool jumpMapDirty = true;// 跳点表是否需要重建
+    float uniformCost = 0.f;// 跳点表中视为均匀代价的值
+    InflateMode inflateMode = InflateMode::None;// 最近一次生成代价地图的方式
+    std::unordered_map<size_t, float> overlaidCost;// 没有膨胀信息时，被updateRegion的障碍物或硬膨胀改为无穷的格子的原代价
+    int inflateRadius = 0;// 膨胀半径（像素）
+    std::vector<std::pair<std::pair<int,int>,std::pair<int,float>>> inflateMask;// 方形膨胀的mask，按权重从大到小
+    std::vector<float> inflateTable;// 圆形膨胀的衰减查找表
+    std::shared_ptr<void> snapshotMapping;// loadSnapshot映射的文件，地图张量可能是它的视图
+    std::vector<int> componentParent;// 8连通分量的并查集，-1为不可通行，根节点的父节点是自己
+    bool componentsDirty = true;// 连通分量是否需要重建（prepare时重建）
+    std::list<DistanceField> fieldCache;// 距离场缓存，最近使用的在前
+    size_t fieldCacheBudget = size_t(256) << 20;// 距离场缓存的内存上限（字节）
+
+public:
+    // @brief 可分步推进的搜索句柄，每次step最多扩展n个节点后返回，适合不能阻塞的单线程控制循环。
+    // 句柄有自己的SearchContext和开集，换目标或取消后重新开始不会重新分配内存。
+    // 按传统A*的邻域扩展（不考虑动量，不使用跳点搜索）；两次step之间不要修改AStar的地图和设置
+    class StepSearch{
+    public:
+        enum class Status{
+            Idle,      // 还没有开始
+            Running,   // 未完成，继续调用step
+            Found,     // 找到路径，见path()
+            NoPath,    // 开集已空，无解
+            Cancelled  // 被cancel()取消
+        };
+
+        explicit StepSearch(const AStar& _astar);
+        StepSearch(const StepSearch&) = delete;// 开集引用了自己的上下文
+        StepSearch& operator=(const StepSearch&) = delete;
+
+        // @brief 开始（或以新的起点终点重新开始）一次搜索，O(1)推进代次，不重新分配节点表
+        void start(std::pair<float, float> start, std::pair<float, float> end);
+
+        // @brief 推进搜索
+        // @param maxExpansions 本次最多扩展的节点数
+        // @return 推进后的状态
+        Status step(int maxExpansions);
+
+        // 取消当前搜索，之后step直接返回Cancelled，直到下一次start
+        void cancel();
+
+        inline Status status() const { return state; }
+        // 已扩展的节点数
+        inline size_t expanded() const { return expandedCount; }
+        // 当前开集大小
+        inline size_t openSize() const { return openList.size(); }
+        // @brief 粗略进度[0, 1]：已扩展节点中离终点最近的启发距离相对起点缩短的比例
+        float progress() const;
+        // 找到的路径，状态为Found时有效
+        inline const std::vector<std::pair<float, float>>& path() const { return result; }
+
+    private:
+        template<typename Heuristic, typename Cost>
+        Status stepWith(const Cost& cost, int maxExpansions);
+
+        const AStar& astar;
+        SearchContext ctx;
+        OpenList openList;
+        Status state = Status::Idle;
+        int startx = 0, starty = 0, endx = 0, endy = 0;
+        size_t expandedCount = 0;
+        long long startDistance2 = 0;// 起点到终点距离的平方（像素^2）
+        long long bestDistance2 = 0;// 已扩展节点中到终点最近距离的平方
+        std::vector<std::pair<float, float>> result;
+    };
 };
 
 #endif // YASTAR_HPP
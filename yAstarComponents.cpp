@@ -0,0 +1,125 @@
+#include "yAstar.hpp"
+#include<algorithm>
+#include<execution>
+#include<ranges>
+#include<thread>
+
+// 并查集的根，不做路径压缩，可以在搜索时并发只读调用
+static inline int findRoot(const std::vector<int>& parent, int i){
+    while(parent[i] != i) i = parent[i];
+    return i;
+}
+
+// 合并两个集合，编号大的根挂到编号小的根下面（路径减半，只写a、b所在树上的节点）
+static inline void unite(std::vector<int>& parent, int a, int b){
+    while(parent[a] != a){
+        parent[a] = parent[parent[a]];
+        a = parent[a];
+    }
+    while(parent[b] != b){
+        parent[b] = parent[parent[b]];
+        b = parent[b];
+    }
+    if(a < b) parent[b] = a;
+    else if(b < a) parent[a] = b;
+}
+
+void AStar::buildComponents(){
+    int width = originMap.shape(1), height = originMap.shape(0);
+    componentParent.assign(static_cast<size_t>(width)*height, -1);
+    std::vector<int>& parent = componentParent;
+    // 条带内只会访问条带内的格子，各条带可以并行
+    int strips = std::max(1, std::min(height, static_cast<int>(std::thread::hardware_concurrency()) * 4));
+    auto stripStart = [&](int s){ return static_cast<int>(static_cast<long long>(height) * s / strips); };
+    auto ids = std::views::iota(0, strips);
+    std::for_each(std::execution::par, ids.begin(), ids.end(), [&](int s){
+        int y0 = stripStart(s), y1 = stripStart(s+1);
+        for(int y=y0; y<y1; y++){
+            for(int x=0; x<width; x++){
+                if(isBlocked(x, y)) continue;
+                int i = y*width+x;
+                parent[i] = i;
+                if(x > 0 && parent[i-1] >= 0) unite(parent, i, i-1);
+                if(y > y0){
+                    for(int dx=-1; dx<=1; dx++){
+                        int nx = x+dx;
+                        if(nx >= 0 && nx < width && parent[i-width+dx] >= 0) unite(parent, i, i-width+dx);
+                    }
+                }
+            }
+        }
+    });
+    // 合并条带边界
+    for(int s=1; s<strips; s++){
+        int y = stripStart(s);
+        if(y <= 0 || y >= height) continue;
+        for(int x=0; x<width; x++){
+            int i = y*width+x;
+            if(parent[i] < 0) continue;
+            for(int dx=-1; dx<=1; dx++){
+                int nx = x+dx;
+                if(nx >= 0 && nx < width && parent[i-width+dx] >= 0) unite(parent, i, i-width+dx);
+            }
+        }
+    }
+    // 压平：只读旧的父节点，写入新数组
+    std::vector<int> roots(parent.size());
+    auto rows = std::views::iota(0, height);
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y){
+        for(int i=y*width; i<(y+1)*width; i++){
+            roots[i] = parent[i] < 0 ? -1 : findRoot(parent, i);
+        }
+    });
+    componentParent.swap(roots);
+    componentsDirty = false;
+}
+
+void AStar::updateComponents(int x0, int y0, int x1, int y1){
+    int width = originMap.shape(1), height = originMap.shape(0);
+    if(componentsDirty || componentParent.size() != static_cast<size_t>(width)*height){
+        componentsDirty = true;// 已经过期，等prepare时整体重建
+        return;
+    }
+    std::vector<int>& parent = componentParent;
+    std::vector<int> opened;// 变为可通行的格子
+    for(int y=y0; y<y1; y++){
+        for(int x=x0; x<x1; x++){
+            int i = y*width+x;
+            bool blocked = isBlocked(x, y);
+            if(blocked && parent[i] >= 0){
+                // 连通分量可能分裂，并查集不支持删除。只标记过期，下一次prepare时重建，
+                // 这样updateRegion的耗时仍然只与窗口有关，连续多次更新也只重建一次
+                componentsDirty = true;
+                return;
+            }
+            if(!blocked && parent[i] < 0){
+                parent[i] = i;
+                opened.push_back(i);
+            }
+        }
+    }
+    for(int i : opened){
+        int x = i%width, y = i/width;
+        for(int dy=-1; dy<=1; dy++){
+            for(int dx=-1; dx<=1; dx++){
+                int nx = x+dx, ny = y+dy;
+                if((dx || dy) && nx >= 0 && nx < width && ny >= 0 && ny < height && parent[ny*width+nx] >= 0){
+                    unite(parent, i, ny*width+nx);
+                }
+            }
+        }
+    }
+}
+
+bool AStar::maybeConnected(size_t from, size_t to) const {
+    if(componentsDirty || from >= componentParent.size() || to >= componentParent.size()){
+        return true;
+    }
+    if(componentParent[to] < 0){
+        return false;// 终点不可通行，永远不会被压入开集
+    }
+    if(componentParent[from] < 0){
+        return true;// 起点本身不可通行时仍然会向邻居扩展，不做判断
+    }
+    return findRoot(componentParent, static_cast<int>(from)) == findRoot(componentParent, static_cast<int>(to));
+}
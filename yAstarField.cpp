@@ -0,0 +1,208 @@
+#include "yAstar.hpp"
+#include<algorithm>
+#include<cmath>
+#include<execution>
+#include<iostream>
+
+// 邻居方向(dy, dx)，前4个为直行，后4个为斜行，与搜索使用的顺序相同
+static constexpr int neighour[8][2] = {{-1,0},{1,0},{0,-1},{0,1},{-1,-1},{-1,1},{1,-1},{1,1}};
+
+// 反向Dijkstra开集的位置句柄
+struct FieldHeapPos{
+    int* pos;
+    inline int& operator()(size_t index) const { return pos[index]; }
+};
+
+void AStar::computeField(size_t goal, int neighbours, YTensor<float,2>& dist) const {
+    int width = costMap.shape(1), height = costMap.shape(0);
+    dist = YTensor<float,2>(height, width);
+    dist.fill(std::numeric_limits<float>::infinity());
+    std::vector<int> heapPos(dist.size(), -1);
+    IndexedHeap<float, FieldHeapPos> openList(FieldHeapPos{heapPos.data()});
+    dist.data[goal] = 0.f;
+    openList.push(goal, 0.f);
+    while(!openList.empty()){
+        size_t v = openList.pop();
+        int x = v%width, y = v/width;
+        float dv = dist.data[v];
+        float cv = costMap.data[v];
+        // 正向搜索从u走到v的代价为 cost(v) * 步长，所以反向时沿邻居方向的反方向找u
+        for(int i = 0; i < neighbours; i++){
+            int ux = x-neighour[i][1], uy = y-neighour[i][0];
+            if(ux<0 || ux>=width || uy<0 || uy>=height || isBlocked(ux, uy)) continue;
+            size_t u = static_cast<size_t>(uy)*width+ux;
+            float du = dv + cv * (1.f + static_cast<int>(i/4)*0.414f);
+            if(du < dist.data[u]){
+                dist.data[u] = du;
+                openList.pushOrUpdate(u, du);
+            }
+        }
+    }
+}
+
+const AStar::DistanceField& AStar::fieldFor(size_t goal){
+    int neighbours = std::clamp(neighourCount, 4, 8);
+    for(auto it = fieldCache.begin(); it != fieldCache.end(); it++){
+        if(it->goal == goal && it->neighbours == neighbours){
+            fieldCache.splice(fieldCache.begin(), fieldCache, it);
+            return fieldCache.front();
+        }
+    }
+    fieldCache.push_front(DistanceField{goal, neighbours, YTensor<float,2>()});
+    computeField(goal, neighbours, fieldCache.front().dist);
+    trimFieldCache();
+    return fieldCache.front();
+}
+
+void AStar::trimFieldCache(){
+    size_t bytes = 0;
+    for(const auto& f : fieldCache){
+        bytes += f.dist.size() * sizeof(float);
+    }
+    while(fieldCache.size() > 1 && bytes > fieldCacheBudget){
+        bytes -= fieldCache.back().dist.size() * sizeof(float);
+        fieldCache.pop_back();
+    }
+}
+
+void AStar::setFieldCacheBudget(size_t bytes){
+    fieldCacheBudget = bytes;
+    trimFieldCache();
+}
+
+void AStar::clearFieldCache(){
+    fieldCache.clear();
+}
+
+void AStar::precomputeFields(const std::vector<std::pair<float, float>>& goals){
+    int width = costMap.shape(1), height = costMap.shape(0);
+    int neighbours = std::clamp(neighourCount, 4, 8);
+    std::vector<DistanceField> fresh;
+    for(const auto& g : goals){
+        int x = g.first/mapping, y = g.second/mapping;
+        if(x<0 || x>=width || y<0 || y>=height) continue;
+        size_t goal = static_cast<size_t>(y)*width+x;
+        auto it = std::find_if(fieldCache.begin(), fieldCache.end(), [&](const DistanceField& f){ return f.goal == goal && f.neighbours == neighbours; });
+        if(it != fieldCache.end()){
+            // 已缓存的也算一次使用，移到最前面，避免被随后放入的新距离场挤出去
+            fieldCache.splice(fieldCache.begin(), fieldCache, it);
+        }else if(std::none_of(fresh.begin(), fresh.end(), [&](const DistanceField& f){ return f.goal == goal; })){
+            fresh.push_back(DistanceField{goal, neighbours, YTensor<float,2>()});
+        }
+    }
+    // 各距离场互不相关，只读地图，可以并行计算
+    std::for_each(std::execution::par, fresh.begin(), fresh.end(), [&](DistanceField& f){
+        computeField(f.goal, f.neighbours, f.dist);
+    });
+    for(auto& f : fresh){
+        fieldCache.push_front(std::move(f));
+    }
+    trimFieldCache();
+}
+
+std::vector<std::pair<float,float>> AStar::searchByField(std::pair<float, float> start, std::pair<float, float> end){
+    int width = costMap.shape(1), height = costMap.shape(0);
+    int x = start.first/mapping, y = start.second/mapping;// 起点
+    int endx = end.first/mapping, endy = end.second/mapping;// 终点
+    std::vector<std::pair<float, float>> path;
+    if(endx<0 || endx>=width || endy<0 || endy>=height || isBlocked(endx, endy)){
+        std::cout<<"No path found!"<<std::endl;
+        return path;
+    }
+    const DistanceField& field = fieldFor(static_cast<size_t>(endy)*width+endx);
+    const float* dist = field.dist.data;
+    path.push_back(std::make_pair(x*mapping, y*mapping));
+    // 沿距离场下降：每一步选 cost(v)*步长 + dist(v) 最小的邻居，距离场精确时就是最优路径
+    float here = std::numeric_limits<float>::infinity();
+    if(x>=0 && x<width && y>=0 && y<height && !isBlocked(x, y)){
+        here = dist[static_cast<size_t>(y)*width+x];
+    }
+    // 代价为0的格子会让相邻格子的距离相等，下降停在平台上时改为在平台内找出口。
+    // 每走出一个平台距离严格下降，步数上限只是保险
+    size_t guard = static_cast<size_t>(width) * height;
+    while((x != endx || y != endy) && guard--){
+        float best = std::numeric_limits<float>::infinity();
+        int bx = -1, by = -1;
+        for(int i = 0; i < field.neighbours; i++){
+            int nx = x+neighour[i][1], ny = y+neighour[i][0];
+            if(nx<0 || nx>=width || ny<0 || ny>=height || isBlocked(nx, ny)) continue;
+            size_t v = static_cast<size_t>(ny)*width+nx;
+            float c = costMap.data[v] * (1.f + static_cast<int>(i/4)*0.414f) + dist[v];
+            if(c < best || (c == best && bx >= 0 && dist[v] < dist[static_cast<size_t>(by)*width+bx])){
+                best = c;// 同分时选距离更小的邻居，能直接下降就不进平台
+                bx = nx;
+                by = ny;
+            }
+        }
+        // 起点不可通行时here为无穷，第一步只要求能走到有限距离的邻居
+        if(bx < 0 || !(best < std::numeric_limits<float>::infinity()) || !(dist[static_cast<size_t>(by)*width+bx] <= here)){
+            std::cout<<"No path found!"<<std::endl;
+            return std::vector<std::pair<float, float>>();
+        }
+        if(dist[static_cast<size_t>(by)*width+bx] < here){
+            x = bx;
+            y = by;
+            path.push_back(std::make_pair(x*mapping, y*mapping));
+        }else if(!walkPlateau(field, x, y, endx, endy, path)){
+            std::cout<<"No path found!"<<std::endl;
+            return std::vector<std::pair<float, float>>();
+        }
+        here = dist[static_cast<size_t>(y)*width+x];
+    }
+    if(x != endx || y != endy){
+        std::cout<<"No path found!"<<std::endl;
+        return std::vector<std::pair<float, float>>();
+    }
+    return path;
+}
+
+bool AStar::walkPlateau(const DistanceField& field, int& x, int& y, int endx, int endy, std::vector<std::pair<float, float>>& path) const {
+    int width = costMap.shape(1), height = costMap.shape(0);
+    const float* dist = field.dist.data;
+    size_t start = static_cast<size_t>(y)*width+x, goal = static_cast<size_t>(endy)*width+endx;
+    float level = dist[start];
+    // 平台内部移动代价为0，出口的总代价就是 cost(出口)*步长 + dist(出口)，取全平台最小的一个
+    std::unordered_map<size_t, size_t> from{{start, start}};
+    std::vector<size_t> queue{start};
+    size_t target = SIZE_MAX, exitCell = SIZE_MAX;
+    float best = std::numeric_limits<float>::infinity();
+    for(size_t head = 0; head < queue.size() && target != goal; head++){
+        size_t u = queue[head];
+        if(u == goal){
+            target = goal;
+            break;
+        }
+        int ux = u%width, uy = u/width;
+        for(int i = 0; i < field.neighbours; i++){
+            int nx = ux+neighour[i][1], ny = uy+neighour[i][0];
+            if(nx<0 || nx>=width || ny<0 || ny>=height || isBlocked(nx, ny)) continue;
+            size_t v = static_cast<size_t>(ny)*width+nx;
+            if(dist[v] == level && costMap.data[v] == 0.f){
+                if(from.emplace(v, u).second) queue.push_back(v);
+            }else if(dist[v] < level){
+                float c = costMap.data[v] * (1.f + static_cast<int>(i/4)*0.414f) + dist[v];
+                if(c < best){
+                    best = c;
+                    target = u;
+                    exitCell = v;
+                }
+            }
+        }
+    }
+    if(target == SIZE_MAX){
+        return false;
+    }
+    std::vector<size_t> walk;
+    for(size_t c = target; c != start; c = from[c]){
+        walk.push_back(c);
+    }
+    if(target != goal){
+        walk.insert(walk.begin(), exitCell);
+    }
+    for(auto it = walk.rbegin(); it != walk.rend(); ++it){
+        path.push_back(std::make_pair((*it%width)*mapping, (*it/width)*mapping));
+    }
+    x = walk.front()%width;
+    y = walk.front()/width;
+    return true;
+}
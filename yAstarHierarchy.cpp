@@ -0,0 +1,337 @@
+#include "yAstarHierarchy.hpp"
+#include<algorithm>
+#include<cmath>
+#include<execution>
+#include<numeric>
+
+// 邻居方向(dy, dx)，与yAstar.cpp中一致
+static constexpr int neighour[8][2] = {{-1,0},{1,0},{0,-1},{0,1},{-1,-1},{-1,1},{1,-1},{1,1}};
+
+// 位置句柄存放在普通数组里的堆
+struct VectorHeapPos{
+    std::vector<int>* pos;
+    inline int& operator()(size_t index) const {
+        return (*pos)[index];
+    }
+};
+
+AStarHierarchy::AStarHierarchy(AStar& _astar, int _clusterSize): astar(_astar), clusterSize(_clusterSize){
+    width = height = 0;
+    clustersX = clustersY = 0;
+    minCost = 1.f;
+}
+
+void AStarHierarchy::build(){
+    height = astar.costMap.shape(0);
+    width = astar.costMap.shape(1);
+    clustersX = (width + clusterSize - 1) / clusterSize;
+    clustersY = (height + clusterSize - 1) / clusterSize;
+    clusters.assign(clustersX * clustersY, Cluster());
+    hBorders.assign(clustersX * clustersY, {});
+    vBorders.assign(clustersX * clustersY, {});
+    minCost = std::reduce(std::execution::par_unseq, astar.costMap.data, astar.costMap.data + astar.costMap.size(), std::numeric_limits<float>::infinity(), [](float a, float b){ return std::min(a, b); });
+    for(int cy=0; cy<clustersY; cy++){
+        for(int cx=0; cx<clustersX; cx++){
+            if(cx+1 < clustersX) buildBorder(cx, cy, true);
+            if(cy+1 < clustersY) buildBorder(cx, cy, false);
+        }
+    }
+    // 各簇互不影响，可以并行
+    std::vector<int> all(clusters.size());
+    std::iota(all.begin(), all.end(), 0);
+    std::for_each(std::execution::par, all.begin(), all.end(), [&](int k){
+        buildCluster(k % clustersX, k / clustersX);
+    });
+    assembleGraph();
+}
+
+void AStarHierarchy::update(int x, int y, int w, int h){
+    if(clusters.empty()){
+        build();
+        return;
+    }
+    // 边界上的入口取决于两侧的格子，所以区域向外扩一格
+    int x0 = std::max(0, x-1), y0 = std::max(0, y-1);
+    int x1 = std::min(width-1, x+w), y1 = std::min(height-1, y+h);
+    if(x0 > x1 || y0 > y1) return;
+    for(int yy=y0; yy<=y1; yy++){
+        for(int xx=x0; xx<=x1; xx++){
+            minCost = std::min(minCost, cellCost(yy*width+xx));// 只会变小，保持启发函数可采纳
+        }
+    }
+    int cx0 = x0 / clusterSize, cy0 = y0 / clusterSize;
+    int cx1 = x1 / clusterSize, cy1 = y1 / clusterSize;
+    // 与受影响簇相接的边界
+    for(int cy=cy0; cy<=cy1; cy++){
+        for(int cx=std::max(0, cx0-1); cx<=cx1 && cx+1<clustersX; cx++){
+            buildBorder(cx, cy, true);
+        }
+    }
+    for(int cy=std::max(0, cy0-1); cy<=cy1 && cy+1<clustersY; cy++){
+        for(int cx=cx0; cx<=cx1; cx++){
+            buildBorder(cx, cy, false);
+        }
+    }
+    // 受影响的簇以及与它们共享边界的簇（入口变了，簇内距离也要重算）
+    std::vector<int> dirty;
+    for(int cy=std::max(0, cy0-1); cy<=std::min(clustersY-1, cy1+1); cy++){
+        for(int cx=std::max(0, cx0-1); cx<=std::min(clustersX-1, cx1+1); cx++){
+            bool insideX = cx>=cx0 && cx<=cx1, insideY = cy>=cy0 && cy<=cy1;
+            if(insideX || insideY) dirty.push_back(cy*clustersX + cx);// 不含对角的簇
+        }
+    }
+    std::for_each(std::execution::par, dirty.begin(), dirty.end(), [&](int k){
+        buildCluster(k % clustersX, k / clustersX);
+    });
+    assembleGraph();
+}
+
+void AStarHierarchy::buildBorder(int cx, int cy, bool horizontal){
+    auto& border = horizontal ? hBorders[cy*clustersX + cx] : vBorders[cy*clustersX + cx];
+    border.clear();
+    // 沿边界方向的范围[t0, t1)，以及两侧格子
+    int t0 = horizontal ? cy*clusterSize : cx*clusterSize;
+    int t1 = horizontal ? std::min(height, (cy+1)*clusterSize) : std::min(width, (cx+1)*clusterSize);
+    int side = horizontal ? (cx+1)*clusterSize - 1 : (cy+1)*clusterSize - 1;
+    auto cellA = [&](int t){ return horizontal ? t*width + side : side*width + t; };
+    auto cellB = [&](int t){ return horizontal ? t*width + side + 1 : (side+1)*width + t; };
+    auto addEntrance = [&](int t){ border.emplace_back(cellA(t), cellB(t)); };
+    int runStart = -1;
+    for(int t=t0; t<=t1; t++){
+        bool open = t < t1 && cellCost(cellA(t)) < std::numeric_limits<float>::infinity() && cellCost(cellB(t)) < std::numeric_limits<float>::infinity();
+        if(open && runStart < 0){
+            runStart = t;
+        }else if(!open && runStart >= 0){
+            // 短的通道放一个入口，长的通道两端各放一个
+            int runEnd = t - 1;
+            if(runEnd - runStart + 1 < 6){
+                addEntrance((runStart + runEnd) / 2);
+            }else{
+                addEntrance(runStart);
+                addEntrance(runEnd);
+            }
+            runStart = -1;
+        }
+    }
+}
+
+void AStarHierarchy::buildCluster(int cx, int cy){
+    int k = cy*clustersX + cx;
+    Cluster& cluster = clusters[k];
+    cluster.portals.clear();
+    for(auto& e : hBorders[k]) cluster.portals.push_back(e.first);
+    for(auto& e : vBorders[k]) cluster.portals.push_back(e.first);
+    if(cx > 0) for(auto& e : hBorders[k-1]) cluster.portals.push_back(e.second);
+    if(cy > 0) for(auto& e : vBorders[k-clustersX]) cluster.portals.push_back(e.second);
+    std::sort(cluster.portals.begin(), cluster.portals.end());
+    cluster.portals.erase(std::unique(cluster.portals.begin(), cluster.portals.end()), cluster.portals.end());
+    size_t n = cluster.portals.size();
+    cluster.dist.assign(n*n, std::numeric_limits<float>::infinity());
+    int x0 = cx*clusterSize, y0 = cy*clusterSize;
+    int cw = std::min(width, x0+clusterSize) - x0;
+    std::vector<float> dist;
+    for(size_t i=0; i<n; i++){
+        clusterDijkstra(k, cluster.portals[i], false, dist);
+        for(size_t j=0; j<n; j++){
+            int p = cluster.portals[j];
+            cluster.dist[i*n+j] = dist[(p/width - y0)*cw + p%width - x0];
+        }
+    }
+}
+
+void AStarHierarchy::assembleGraph(){
+    portalCells.clear();
+    portalId.clear();
+    for(auto& cluster : clusters){
+        for(int p : cluster.portals){
+            portalId[p] = static_cast<int>(portalCells.size());
+            portalCells.push_back(p);
+        }
+    }
+    graph.assign(portalCells.size(), {});
+    // 簇内边
+    for(auto& cluster : clusters){
+        size_t n = cluster.portals.size();
+        for(size_t i=0; i<n; i++){
+            auto& edges = graph[portalId[cluster.portals[i]]];
+            for(size_t j=0; j<n; j++){
+                float d = cluster.dist[i*n+j];
+                if(i != j && d < std::numeric_limits<float>::infinity()){
+                    edges.push_back(Edge{portalId[cluster.portals[j]], d});
+                }
+            }
+        }
+    }
+    // 簇间边，代价为进入对面格子的代价
+    for(auto* borders : {&hBorders, &vBorders}){
+        for(auto& border : *borders){
+            for(auto& e : border){
+                graph[portalId[e.first]].push_back(Edge{portalId[e.second], cellCost(e.second)});
+                graph[portalId[e.second]].push_back(Edge{portalId[e.first], cellCost(e.first)});
+            }
+        }
+    }
+}
+
+void AStarHierarchy::clusterDijkstra(int cluster, int source, bool reverse, std::vector<float>& dist){
+    int x0 = (cluster % clustersX) * clusterSize, y0 = (cluster / clustersX) * clusterSize;
+    int cw = std::min(width, x0+clusterSize) - x0, ch = std::min(height, y0+clusterSize) - y0;
+    dist.assign(cw*ch, std::numeric_limits<float>::infinity());
+    std::vector<int> pos(cw*ch, -1);
+    IndexedHeap<float, VectorHeapPos> heap(VectorHeapPos{&pos});
+    int s = (source/width - y0)*cw + source%width - x0;
+    dist[s] = 0.f;
+    heap.push(s, 0.f);
+    while(!heap.empty()){
+        int u = static_cast<int>(heap.pop());
+        int ux = u % cw, uy = u / cw;
+        float du = dist[u];
+        for(int i=0; i<8; i++){
+            int vx = ux + neighour[i][1], vy = uy + neighour[i][0];
+            if(vx<0 || vx>=cw || vy<0 || vy>=ch) continue;
+            float cv = cellCost((vy+y0)*width + vx+x0);
+            if(!(cv < std::numeric_limits<float>::infinity())) continue;
+            // 正向为进入邻居的代价；反向时邻居走到u，代价为进入u的代价
+            float w = reverse ? cellCost((uy+y0)*width + ux+x0) : cv;
+            float nd = du + w * (1.f + static_cast<int>(i/4)*0.414f);
+            int v = vy*cw + vx;
+            if(nd < dist[v]){
+                dist[v] = nd;
+                heap.pushOrUpdate(v, nd);
+            }
+        }
+    }
+}
+
+std::vector<std::pair<float,float>> AStarHierarchy::search(std::pair<float, float> start, std::pair<float, float> end){
+    if(clusters.empty()){
+        build();
+    }
+    float mapping = astar.mapping;
+    int sx = start.first/mapping, sy = start.second/mapping;
+    int gx = end.first/mapping, gy = end.second/mapping;
+    if(sx<0 || sx>=width || sy<0 || sy>=height || gx<0 || gx>=width || gy<0 || gy>=height
+        || !(cellCost(sy*width+sx) < std::numeric_limits<float>::infinity()) || !(cellCost(gy*width+gx) < std::numeric_limits<float>::infinity())){
+        std::cout<<"No path found!"<<std::endl;
+        return std::vector<std::pair<float, float>>();
+    }
+    int sIndex = sy*width+sx, gIndex = gy*width+gx;
+    int cs = clusterOf(sx, sy), cg = clusterOf(gx, gy);
+    auto local = [&](int cluster, int cell){
+        int x0 = (cluster % clustersX) * clusterSize, y0 = (cluster / clustersX) * clusterSize;
+        int cw = std::min(width, x0+clusterSize) - x0;
+        return (cell/width - y0)*cw + cell%width - x0;
+    };
+    // 起点到本簇入口、本簇入口到终点的代价
+    std::vector<float> dS, dG;
+    clusterDijkstra(cs, sIndex, false, dS);
+    clusterDijkstra(cg, gIndex, true, dG);
+
+    // 抽象图上的A*，起点和终点作为两个临时节点
+    int n = static_cast<int>(portalCells.size());
+    int S = n, G = n+1;
+    auto cellOf = [&](int id){ return id < n ? portalCells[id] : (id == S ? sIndex : gIndex); };
+    std::vector<float> g(n+2, std::numeric_limits<float>::infinity());
+    std::vector<int> parent(n+2, -1), pos(n+2, -1);
+    std::vector<char> closed(n+2, 0);
+    IndexedHeap<float, VectorHeapPos> openList(VectorHeapPos{&pos});
+    auto heuristic = [&](int id){
+        int c = cellOf(id);
+        return std::hypotf(c%width - gx, c/width - gy) * minCost;
+    };
+    auto relax = [&](int from, int to, float cost){
+        if(closed[to] || !(cost < std::numeric_limits<float>::infinity())) return;
+        float ng = g[from] + cost;
+        if(ng < g[to]){
+            g[to] = ng;
+            parent[to] = from;
+            openList.pushOrUpdate(to, ng + heuristic(to));
+        }
+    };
+    g[S] = 0.f;
+    openList.push(S, heuristic(S));
+    while(!openList.empty()){
+        int u = static_cast<int>(openList.pop());
+        if(u == G) break;
+        closed[u] = 1;
+        if(u == S){
+            for(int p : clusters[cs].portals){
+                relax(S, portalId[p], dS[local(cs, p)]);
+            }
+            if(cs == cg){
+                relax(S, G, dS[local(cs, gIndex)]);
+            }
+            continue;
+        }
+        for(auto& e : graph[u]){
+            relax(u, e.to, e.cost);
+        }
+        int c = portalCells[u];
+        if(clusterOf(c%width, c/width) == cg){
+            relax(u, G, dG[local(cg, c)]);
+        }
+    }
+    if(!(g[G] < std::numeric_limits<float>::infinity())){
+        std::cout<<"No path found!"<<std::endl;
+        return std::vector<std::pair<float, float>>();
+    }
+    std::vector<int> abstractPath;
+    for(int id=G; id!=-1; id=parent[id]){
+        abstractPath.push_back(cellOf(id));
+    }
+    std::reverse(abstractPath.begin(), abstractPath.end());
+
+    // 细化：同簇的相邻节点用限制在簇内的底层搜索连接，跨簇的相邻节点本身就是相邻格子。
+    // 借用astar自己的上下文，不再另外分配整张地图的节点表；固定按传统8邻居搜索，与簇内距离的代价模型一致
+    std::vector<std::pair<float, float>> path;
+    astar.prepare();
+    AStar::SearchContext& context = astar.context;
+    context.resize(width, height);
+    context.quiet = true;// 簇内失败还会放宽窗口，不打印
+    context.traditional8 = true;
+    // 窗口设为簇a和簇b的外接矩形
+    auto setWindow = [&](int a, int b){
+        int ax = a % clustersX, ay = a / clustersX, bx = b % clustersX, by = b / clustersX;
+        context.windowX0 = std::min(ax, bx) * clusterSize;
+        context.windowY0 = std::min(ay, by) * clusterSize;
+        context.windowX1 = std::min(width, (std::max(ax, bx) + 1) * clusterSize);
+        context.windowY1 = std::min(height, (std::max(ay, by) + 1) * clusterSize);
+    };
+    auto clusterOfCell = [&](int cell){ return clusterOf(cell%width, cell/width); };
+    bool broken = false;
+    for(size_t i=0; i+1<abstractPath.size() && !broken; i++){
+        int u = abstractPath[i], v = abstractPath[i+1];
+        int ux = u%width, uy = u/width, vx = v%width, vy = v/width;
+        std::pair<float,float> from(ux*mapping, uy*mapping), to(vx*mapping, vy*mapping);
+        std::vector<std::pair<float, float>> leg;
+        int k = clusterOf(ux, uy);
+        if(k == clusterOf(vx, vy)){
+            setWindow(k, k);
+            leg = astar.search(context, from, to);
+            // 簇内距离与细化使用同一代价模型，正常不会失败；万一失败，只放宽到路径进入或离开本簇时相邻的那个簇
+            int other = i > 0 ? clusterOfCell(abstractPath[i-1]) : (i+2 < abstractPath.size() ? clusterOfCell(abstractPath[i+2]) : k);
+            if(leg.empty() && other != k){
+                setWindow(k, other);
+                leg = astar.search(context, from, to);
+            }
+            broken = leg.empty();
+        }else{
+            leg = {from, to};
+        }
+        if(!broken){
+            path.insert(path.end(), path.empty() ? leg.begin() : leg.begin()+1, leg.end());
+        }
+    }
+    // 还原astar上下文的窗口和模式，不影响之后的AStar::search
+    context.resize(width, height);
+    context.quiet = false;
+    context.traditional8 = false;
+    if(broken){
+        std::cout<<"No path found!"<<std::endl;
+        return std::vector<std::pair<float, float>>();
+    }
+    if(path.empty()){
+        path.emplace_back(sx*mapping, sy*mapping);
+    }
+    return path;
+}
@@ -0,0 +1,70 @@
+#ifndef YASTAR_HIERARCHY_HPP
+#define YASTAR_HIERARCHY_HPP
+
+#include <vector>
+#include <unordered_map>
+#include "yAstar.hpp"
+
+// @brief 建立在AStar之上的分层(HPA*)抽象层，用于超大地图上的长距离查询。
+// 地图被切成 clusterSize x clusterSize 的簇，簇之间的边界上放置入口(portal)，簇内入口两两之间的距离按代价地图预计算。
+// 查询时先在抽象图上搜索，再只对起点簇、终点簇和选中走廊上的簇调用AStar的底层搜索细化（借用AStar自己的搜索上下文，固定按传统8邻居搜索）。
+// 抽象图的代价按传统8邻居模型计算（进入格子的代价，斜行乘1.414），与setTraditional(true)时的search一致。
+class AStarHierarchy{
+public:
+    // @param _astar 底层搜索器，需要已经设置好代价地图，分层对象不拥有它
+    // @param _clusterSize 簇边长（像素）
+    AStarHierarchy(AStar& _astar, int _clusterSize = 64);
+
+    // 按当前代价地图构建整个抽象图
+    void build();
+
+    // @brief 代价地图中的矩形区域改变后，只重建受影响的簇
+    // @param x,y,w,h 改变的矩形（像素）
+    void update(int x, int y, int w, int h);
+
+    // @brief 分层搜索路径，参数和返回值与AStar::search一致
+    std::vector<std::pair<float, float>> search(std::pair<float, float> start, std::pair<float, float> end);
+
+    // 抽象图节点（入口）个数
+    size_t portalCount() const { return portalCells.size(); }
+
+protected:
+    // 簇内的入口及其两两距离
+    struct Cluster{
+        std::vector<int> portals;// 入口格子索引
+        std::vector<float> dist; // portals.size()^2 的距离矩阵，dist[i*n+j]为i到j的代价
+    };
+    // 抽象图的边
+    struct Edge{
+        int to;
+        float cost;
+    };
+
+    // 计算两个相邻簇之间的入口，horizontal为true表示左右相邻
+    void buildBorder(int cx, int cy, bool horizontal);
+    // 重新收集簇的入口并计算簇内距离
+    void buildCluster(int cx, int cy);
+    // 重新组装抽象图
+    void assembleGraph();
+    // @brief 簇内Dijkstra
+    // @param reverse 为true时计算各格子到source的代价，否则计算source到各格子的代价
+    // @param dist 输出，按簇内局部坐标存放
+    void clusterDijkstra(int cluster, int source, bool reverse, std::vector<float>& dist);
+
+    inline int clusterOf(int x, int y) const { return (y / clusterSize) * clustersX + x / clusterSize; }
+    inline float cellCost(int index) const { return astar.costMap.data[index]; }
+
+    AStar& astar;
+    int clusterSize;
+    int width, height;
+    int clustersX, clustersY;
+    float minCost;// 最小有限代价，用于抽象图的启发函数
+    std::vector<Cluster> clusters;
+    std::vector<std::vector<std::pair<int,int>>> hBorders;// 簇(cx,cy)与(cx+1,cy)之间的入口对
+    std::vector<std::vector<std::pair<int,int>>> vBorders;// 簇(cx,cy)与(cx,cy+1)之间的入口对
+    std::vector<int> portalCells;// 抽象图节点对应的格子
+    std::unordered_map<int,int> portalId;// 格子到抽象图节点的映射
+    std::vector<std::vector<Edge>> graph;// 抽象图邻接表
+};
+
+#endif // YASTAR_HIERARCHY_HPP
@@ -0,0 +1,229 @@
+#include "yAstar.hpp"
+#include<algorithm>
+#include<execution>
+#include<ranges>
+#include<limits>
+#include<cmath>
+#include<cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include<immintrin.h>
+#define YASTAR_X86 1
+#endif
+
+// 方形膨胀的行内核
+// @param src 填充后窗口中该行的第一个像素，障碍物为0，窗口外的填充为255
+// @param count 像素个数
+// @param offsets mask在填充窗口中的相对偏移
+// @param weights mask的权重，从大到小
+// @param maskCount mask个数
+// @param baseCost 没有碰到障碍物时的代价
+// @param dst 输出
+using InflateRowKernel = void(*)(const u_char* src, int count, const int* offsets, const float* weights, int maskCount, float baseCost, float* dst);
+
+static void inflateRowScalar(const u_char* src, int count, const int* offsets, const float* weights, int maskCount, float baseCost, float* dst){
+    for(int p=0;p<count;p++){
+        float c = baseCost;
+        if(src[p] == 0){
+            c = std::numeric_limits<float>::infinity();
+        }else{
+            for(int k=0;k<maskCount;k++){
+                if(src[p+offsets[k]] == 0){
+                    // 碰到了障碍物，直接结算！
+                    c = weights[k];
+                    break;
+                }
+            }
+        }
+        dst[p] = c;
+    }
+}
+
+#ifdef YASTAR_X86
+// 一次处理8个像素，8个像素都碰到障碍物后提前结束
+__attribute__((target("avx2")))
+static void inflateRowAVX2(const u_char* src, int count, const int* offsets, const float* weights, int maskCount, float baseCost, float* dst){
+    const __m128i zero = _mm_setzero_si128();
+    const __m256 inf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    const __m256 base = _mm256_set1_ps(baseCost);
+    int p = 0;
+    for(; p+8<=count; p+=8){
+        // 0字节比较得到0xFF，符号扩展成32位掩码
+        __m256i done = _mm256_cvtepi8_epi32(_mm_cmpeq_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src+p)), zero));
+        __m256 result = _mm256_blendv_ps(base, inf, _mm256_castsi256_ps(done));
+        for(int k=0; k<maskCount && _mm256_movemask_ps(_mm256_castsi256_ps(done)) != 0xFF; k++){
+            __m256i hit = _mm256_cvtepi8_epi32(_mm_cmpeq_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src+p+offsets[k])), zero));
+            hit = _mm256_andnot_si256(done, hit);
+            result = _mm256_blendv_ps(result, _mm256_set1_ps(weights[k]), _mm256_castsi256_ps(hit));
+            done = _mm256_or_si256(done, hit);
+        }
+        _mm256_storeu_ps(dst+p, result);
+    }
+    inflateRowScalar(src+p, count-p, offsets, weights, maskCount, baseCost, dst+p);
+}
+
+// 一次处理16个像素，比较直接得到掩码寄存器
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void inflateRowAVX512(const u_char* src, int count, const int* offsets, const float* weights, int maskCount, float baseCost, float* dst){
+    const __m128i zero = _mm_setzero_si128();
+    const __m512 inf = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+    const __m512 base = _mm512_set1_ps(baseCost);
+    int p = 0;
+    for(; p+16<=count; p+=16){
+        __mmask16 done = _mm_cmpeq_epi8_mask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src+p)), zero);
+        __m512 result = _mm512_mask_mov_ps(base, done, inf);
+        for(int k=0; k<maskCount && done != 0xFFFF; k++){
+            __mmask16 hit = _mm_mask_cmpeq_epi8_mask(static_cast<__mmask16>(~done), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src+p+offsets[k])), zero);
+            result = _mm512_mask_mov_ps(result, hit, _mm512_set1_ps(weights[k]));
+            done |= hit;
+        }
+        _mm512_storeu_ps(dst+p, result);
+    }
+    inflateRowScalar(src+p, count-p, offsets, weights, maskCount, baseCost, dst+p);
+}
+#endif
+
+// 按CPU支持的指令集选择行内核，只在第一次调用时检测
+static InflateRowKernel inflateRowKernel(){
+    static const InflateRowKernel kernel = []() -> InflateRowKernel {
+#ifdef YASTAR_X86
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl")){
+            return inflateRowAVX512;
+        }
+        if(__builtin_cpu_supports("avx2")){
+            return inflateRowAVX2;
+        }
+#endif
+        return inflateRowScalar;
+    }();
+    return kernel;
+}
+
+void AStar::inflateSquare(int x0, int y0, int x1, int y1){
+    int width = originMap.shape(1), height = originMap.shape(0);
+    int r = inflateRadius;
+    // 复制窗口并向四周填充r个空白像素，内核里就不需要边界判断了
+    int paddedWidth = x1-x0+2*r, paddedHeight = y1-y0+2*r;
+    std::vector<u_char> padded(static_cast<size_t>(paddedWidth)*paddedHeight, 255);
+    for(int py=0; py<paddedHeight; py++){
+        int yy = y0-r+py;
+        if(yy<0 || yy>=height) continue;
+        int sx0 = std::max(0, x0-r), sx1 = std::min(width, x1+r);
+        std::copy(originMap.data+yy*width+sx0, originMap.data+yy*width+sx1, padded.data()+py*paddedWidth+(sx0-(x0-r)));
+    }
+    std::vector<int> offsets(inflateMask.size());
+    std::vector<float> weights(inflateMask.size());
+    for(size_t k=0; k<inflateMask.size(); k++){
+        offsets[k] = inflateMask[k].first.second*paddedWidth + inflateMask[k].first.first;
+        weights[k] = inflateMask[k].second.second;
+    }
+    InflateRowKernel kernel = inflateRowKernel();
+    auto rows = std::views::iota(y0, y1);
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int yy){
+        const u_char* src = padded.data() + (yy-y0+r)*paddedWidth + r;
+        kernel(src, x1-x0, offsets.data(), weights.data(), static_cast<int>(offsets.size()), costWeight, costMap.data+yy*width+x0);
+    });
+}
+
+////////////////////////////// 位图 //////////////////////////////
+
+// row |= row整体向x增大方向移动s位（s>=0），原地操作，从高位字往低位字处理
+static inline void orShiftUp(uint64_t* row, int words, int s){
+    int ws = s >> 6, bs = s & 63;
+    for(int w=words-1; w>=ws; w--){
+        uint64_t v = row[w-ws] << bs;
+        if(bs && w-ws-1 >= 0) v |= row[w-ws-1] >> (64-bs);
+        row[w] |= v;
+    }
+}
+
+// row |= row整体向x减小方向移动s位（s>=0），原地操作，从低位字往高位字处理
+static inline void orShiftDown(uint64_t* row, int words, int s){
+    int ws = s >> 6, bs = s & 63;
+    for(int w=0; w+ws<words; w++){
+        uint64_t v = row[w+ws] >> bs;
+        if(bs && w+ws+1 < words) v |= row[w+ws+1] << (64-bs);
+        row[w] |= v;
+    }
+}
+
+// 水平膨胀k格：row[x] = OR(row[x-k .. x+k])，按倍增步长，只需要O(log k)次移位
+static void dilateRow(uint64_t* row, int words, int k){
+    if(k <= 0) return;
+    int span = 1;// row当前覆盖[x-span+1, x]
+    while(span*2 <= k+1){
+        orShiftUp(row, words, span);
+        span *= 2;
+    }
+    if(span < k+1){
+        orShiftUp(row, words, k+1-span);
+    }
+    orShiftDown(row, words, k);
+}
+
+void AStar::packOccupancy(int y0, int y1){
+    int width = originMap.shape(1), words = occupancyMap.shape(1);
+    auto rows = std::views::iota(y0, y1);
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y){
+        const u_char* src = originMap.data + static_cast<size_t>(y)*width;
+        uint64_t* dst = occupancyMap.data + static_cast<size_t>(y)*words;
+        for(int w=0; w<words; w++){
+            uint64_t bits = 0;
+            int x0 = w*64, n = std::min(64, width-x0);
+            for(int b=0; b<n; b++){
+                bits |= static_cast<uint64_t>(src[x0+b] == 0) << b;
+            }
+            dst[w] = bits;
+        }
+    });
+}
+
+void AStar::packBlocked(int y0, int y1){
+    int width = costMap.shape(1), words = blockedMap.shape(1);
+    auto rows = std::views::iota(y0, y1);
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y){
+        const float* src = costMap.data + static_cast<size_t>(y)*width;
+        uint64_t* dst = blockedMap.data + static_cast<size_t>(y)*words;
+        for(int w=0; w<words; w++){
+            uint64_t bits = 0;
+            int x0 = w*64, n = std::min(64, width-x0);
+            for(int b=0; b<n; b++){
+                bits |= static_cast<uint64_t>(!(src[x0+b] < std::numeric_limits<float>::infinity())) << b;
+            }
+            dst[w] = bits;
+        }
+    });
+}
+
+void AStar::applyHardInflation(int x0, int y0, int x1, int y1){
+    int width = costMap.shape(1), height = costMap.shape(0), words = occupancyMap.shape(1);
+    int r = hardInflateRadius;
+    // 圆在第dy行的半宽：dx^2 <= r^2 - dy^2
+    std::vector<int> halfWidth(r+1);
+    for(int dy=0; dy<=r; dy++){
+        int k = static_cast<int>(std::sqrt(static_cast<float>(r*r - dy*dy)));
+        while(k*k > r*r - dy*dy) k--;
+        while((k+1)*(k+1) <= r*r - dy*dy) k++;
+        halfWidth[dy] = k;
+    }
+    auto rows = std::views::iota(y0, y1);
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y){
+        std::vector<uint64_t> acc(words, 0), line(words);
+        for(int dy=-r; dy<=r; dy++){
+            int sy = y+dy;
+            if(sy<0 || sy>=height) continue;
+            const uint64_t* src = occupancyMap.data + static_cast<size_t>(sy)*words;
+            std::copy(src, src+words, line.begin());
+            dilateRow(line.data(), words, halfWidth[std::abs(dy)]);
+            for(int w=0; w<words; w++){
+                acc[w] |= line[w];
+            }
+        }
+        float* dst = costMap.data + static_cast<size_t>(y)*width;
+        for(int x=x0; x<x1; x++){
+            if((acc[x>>6] >> (x&63)) & 1u){
+                dst[x] = std::numeric_limits<float>::infinity();
+            }
+        }
+    });
+}
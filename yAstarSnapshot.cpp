@@ -0,0 +1,317 @@
+#include "yAstar.hpp"
+#include<algorithm>
+#include<cmath>
+#include<fstream>
+#include<cstring>
+#include<type_traits>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+
+// 快照文件格式：文件头 + 各段数据，段的起始位置按64字节对齐，映射后可以直接作为YTensor的数据
+namespace {
+
+constexpr char snapshotMagic[8] = {'Y','A','S','T','A','R','S','N'};
+constexpr uint32_t snapshotVersion = 2;// 2：增加OverlaidCost段
+constexpr uint32_t snapshotByteOrder = 0x01020304u;// 读出来不相等说明是另一种字节序写的
+constexpr uint64_t snapshotAlignment = 64;
+
+enum Section{
+    OriginMap, CostMap, CostMap8, CostMap16, OccupancyMap, BlockedMap, JumpMap, InflateMask, InflateTable, OverlaidCost,
+    SectionCount
+};
+
+struct SnapshotSection{
+    uint64_t offset;
+    uint64_t bytes;// 0表示没有该段
+};
+
+struct SnapshotHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t jumpCellSize;// sizeof(JumpCell)，编译器布局不同时拒绝载入
+    int32_t width, height;
+    float mapping, stride, speed;
+    int32_t neighourCount;
+    float costWeight;
+    uint8_t traditional, jumpPointSearch, jumpMapValid, reserved;
+    int32_t heuristic, queuePolicy;
+    float bucketWidth, costQuantum, uniformCost;
+    int32_t hardInflateRadius;
+    int32_t costStorage;
+    float storageQuantum, quant8Step;
+    int32_t inflateMode, inflateRadius;
+    SnapshotSection sections[SectionCount];
+};
+static_assert(std::is_trivially_copyable_v<SnapshotHeader>);
+
+// 方形膨胀mask的一项，与inflateMask的元素一一对应
+struct SnapshotMaskEntry{
+    int32_t a, b, bias;
+    float weight;
+};
+
+constexpr int32_t maxNeighourCount = 360;// 每度一个方向已经足够
+constexpr uint64_t maxMotionEntries = uint64_t(1) << 24;// 动量模式运动基元表的上限（128MB）
+
+// 枚举值在范围内，数值参数满足对应setter的约束（文件被截断或篡改时这里拦下，之后的搜索不会越界）
+bool validParameters(const SnapshotHeader& h){
+    auto finite = [](float v){ return std::isfinite(v); };
+    // buildMotionTable按(2*ceil(S)+1)^2*neighourCount分配，S为映射后的速度，不能超过地图大小
+    auto motionEntries = [&](){
+        double speedCount = 2. * (std::floor(static_cast<double>(h.speed) / h.mapping) + 1.) + 1.;
+        return speedCount * speedCount * h.neighourCount;
+    };
+    return finite(h.mapping) && h.mapping > 0.f
+        && finite(h.stride) && h.stride > 0.f
+        && finite(h.speed) && h.speed >= 0.f && h.speed / h.mapping <= std::max(h.width, h.height)
+        && h.neighourCount > 0 && h.neighourCount <= maxNeighourCount && (!h.traditional || h.neighourCount >= 4)
+        && motionEntries() <= static_cast<double>(maxMotionEntries)
+        && finite(h.costWeight) && h.costWeight > 0.f
+        && h.heuristic >= static_cast<int32_t>(AStar::HeuristicPolicy::Euclidean) && h.heuristic <= static_cast<int32_t>(AStar::HeuristicPolicy::Octile)
+        && h.queuePolicy >= static_cast<int32_t>(AStar::QueuePolicy::BinaryHeap) && h.queuePolicy <= static_cast<int32_t>(AStar::QueuePolicy::Bucket)
+        && h.costStorage >= static_cast<int32_t>(AStar::CostStorage::Float32) && h.costStorage <= static_cast<int32_t>(AStar::CostStorage::BFloat16)
+        && finite(h.bucketWidth) && finite(h.costQuantum) && h.costQuantum >= 0.f
+        && finite(h.storageQuantum) && finite(h.quant8Step) && h.quant8Step > 0.f
+        && h.hardInflateRadius >= 0 && h.hardInflateRadius <= std::max(h.width, h.height)
+        && h.inflateRadius >= 0 && h.inflateRadius <= std::max(h.width, h.height);
+}
+
+// 没有膨胀信息的代价地图上，被障碍物或硬膨胀改为无穷的格子的原代价，与overlaidCost的元素一一对应
+struct SnapshotOverlayEntry{
+    uint64_t index;
+    float cost;
+    uint32_t reserved;
+};
+
+inline uint64_t alignUp(uint64_t x){
+    return (x + snapshotAlignment - 1) / snapshotAlignment * snapshotAlignment;
+}
+
+template<typename T>
+inline uint64_t tensorBytes(const YTensor<T,2>& t){
+    return t.data == nullptr ? 0 : t.size() * sizeof(T);
+}
+
+// 把段映射为rows*cols的视图，段为空时置为空张量
+template<typename T>
+bool mapSection(char* base, const SnapshotSection& s, int rows, int cols, YTensor<T,2>& out){
+    if(s.bytes == 0){
+        out = YTensor<T,2>();
+        return true;
+    }
+    if(s.bytes != static_cast<uint64_t>(rows) * cols * sizeof(T)){
+        return false;
+    }
+    out = YTensor<T,2>::view(reinterpret_cast<T*>(base + s.offset), {rows, cols});
+    return true;
+}
+
+}
+
+bool AStar::saveSnapshot(const std::string& path) const {
+    if(originMap.data == nullptr){
+        return false;
+    }
+    std::vector<SnapshotMaskEntry> mask(inflateMask.size());
+    std::transform(inflateMask.begin(), inflateMask.end(), mask.begin(), [](const auto& m){
+        return SnapshotMaskEntry{m.first.first, m.first.second, m.second.first, m.second.second};
+    });
+    // 按格子排序，同样的状态总是写出同样的文件
+    std::vector<SnapshotOverlayEntry> overlay;
+    overlay.reserve(overlaidCost.size());
+    for(const auto& [index, cost] : overlaidCost){
+        overlay.push_back(SnapshotOverlayEntry{index, cost, 0});
+    }
+    std::sort(overlay.begin(), overlay.end(), [](const auto& a, const auto& b){ return a.index < b.index; });
+    bool jumpMapValid = !jumpMapDirty && jumpMap.data != nullptr;
+    const void* payload[SectionCount] = {
+        originMap.data, costMap.data, costMap8.data, costMap16.data, occupancyMap.data, blockedMap.data,
+        jumpMap.data, mask.data(), inflateTable.data(), overlay.data()
+    };
+    uint64_t bytes[SectionCount] = {
+        tensorBytes(originMap), tensorBytes(costMap), tensorBytes(costMap8), tensorBytes(costMap16),
+        tensorBytes(occupancyMap), tensorBytes(blockedMap), jumpMapValid ? tensorBytes(jumpMap) : 0,
+        mask.size() * sizeof(SnapshotMaskEntry), inflateTable.size() * sizeof(float), overlay.size() * sizeof(SnapshotOverlayEntry)
+    };
+
+    SnapshotHeader header{};
+    std::copy(snapshotMagic, snapshotMagic + 8, header.magic);
+    header.version = snapshotVersion;
+    header.byteOrder = snapshotByteOrder;
+    header.jumpCellSize = sizeof(JumpCell);
+    header.width = originMap.shape(1);
+    header.height = originMap.shape(0);
+    header.mapping = mapping;
+    header.stride = stride;
+    header.speed = speed;
+    header.neighourCount = neighourCount;
+    header.costWeight = costWeight;
+    header.traditional = traditional;
+    header.jumpPointSearch = jumpPointSearch;
+    header.jumpMapValid = jumpMapValid;
+    header.heuristic = static_cast<int32_t>(heuristic);
+    header.queuePolicy = static_cast<int32_t>(queuePolicy);
+    header.bucketWidth = bucketWidth;
+    header.costQuantum = costQuantum;
+    header.uniformCost = jumpMapValid ? uniformCost : 0.f;
+    header.hardInflateRadius = hardInflateRadius;
+    header.costStorage = static_cast<int32_t>(costStorage);
+    header.storageQuantum = storageQuantum;
+    header.quant8Step = quant8Step;
+    header.inflateMode = static_cast<int32_t>(inflateMode);
+    header.inflateRadius = inflateRadius;
+    uint64_t offset = alignUp(sizeof(SnapshotHeader));
+    for(int s=0; s<SectionCount; s++){
+        header.sections[s] = SnapshotSection{bytes[s] ? offset : 0, bytes[s]};
+        offset = alignUp(offset + bytes[s]);
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if(!out){
+        return false;
+    }
+    const char zeros[snapshotAlignment] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    for(int s=0; s<SectionCount; s++){
+        if(bytes[s] == 0){
+            continue;
+        }
+        out.write(zeros, header.sections[s].offset - written);
+        out.write(static_cast<const char*>(payload[s]), bytes[s]);
+        written = header.sections[s].offset + bytes[s];
+    }
+    return static_cast<bool>(out);
+}
+
+bool AStar::loadSnapshot(const std::string& path){
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        return false;
+    }
+    struct stat st;
+    if(::fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < sizeof(SnapshotHeader)){
+        ::close(fd);
+        return false;
+    }
+    size_t fileBytes = st.st_size;
+    // 先读文件头并校验各段的位置，确认都在文件之内后再映射
+    SnapshotHeader header;
+    if(::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+        || !std::equal(snapshotMagic, snapshotMagic + 8, header.magic) || header.version != snapshotVersion
+        || header.byteOrder != snapshotByteOrder || header.jumpCellSize != sizeof(JumpCell)
+        || header.width <= 0 || header.height <= 0 || !validParameters(header)){
+        ::close(fd);
+        return false;
+    }
+    for(const auto& s : header.sections){
+        // 段必须在文件头之后、文件之内，映射后才能安全地当作张量使用
+        if(s.bytes != 0 && (s.offset % snapshotAlignment != 0 || s.offset < alignUp(sizeof(SnapshotHeader))
+            || s.offset > fileBytes || s.bytes > fileBytes - s.offset)){
+            ::close(fd);
+            return false;
+        }
+    }
+    // 私有可写映射：updateRegion、硬膨胀等写入时按页复制，文件本身不会被修改
+    void* addr = ::mmap(nullptr, fileBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(addr == MAP_FAILED){
+        return false;
+    }
+    std::shared_ptr<void> fileMapping(addr, [fileBytes](void* p){ ::munmap(p, fileBytes); });
+    char* base = static_cast<char*>(addr);
+
+    const SnapshotSection* sections = header.sections;
+    int width = header.width, height = header.height, words = (width+63)/64;
+    if(sections[OriginMap].bytes == 0 || sections[OccupancyMap].bytes == 0 || sections[BlockedMap].bytes == 0
+        || sections[InflateMask].bytes % sizeof(SnapshotMaskEntry) != 0 || sections[InflateTable].bytes % sizeof(float) != 0
+        || sections[OverlaidCost].bytes % sizeof(SnapshotOverlayEntry) != 0){
+        return false;
+    }
+
+    // 膨胀参数要与膨胀方式配套：圆形膨胀按距离平方查表，方形膨胀的偏移不能超出半径
+    const SnapshotMaskEntry* mask = reinterpret_cast<const SnapshotMaskEntry*>(base + sections[InflateMask].offset);
+    size_t maskCount = sections[InflateMask].bytes / sizeof(SnapshotMaskEntry);
+    size_t tableCount = sections[InflateTable].bytes / sizeof(float);
+    int r = header.inflateRadius;
+    auto mode = static_cast<InflateMode>(header.inflateMode);
+    if(header.inflateMode < static_cast<int32_t>(InflateMode::None) || header.inflateMode > static_cast<int32_t>(InflateMode::Disk)
+        || (mode == InflateMode::Disk && tableCount != static_cast<size_t>(r)*r + 1)
+        || std::any_of(mask, mask + maskCount, [r](const SnapshotMaskEntry& m){ return std::abs(m.a) > r || std::abs(m.b) > r; })){
+        return false;
+    }
+    // 记下的原代价只能属于地图内的格子，而且是有限值
+    const SnapshotOverlayEntry* overlay = reinterpret_cast<const SnapshotOverlayEntry*>(base + sections[OverlaidCost].offset);
+    size_t overlayCount = sections[OverlaidCost].bytes / sizeof(SnapshotOverlayEntry);
+    if(std::any_of(overlay, overlay + overlayCount, [&](const SnapshotOverlayEntry& e){
+        return e.index >= static_cast<uint64_t>(width) * height || !std::isfinite(e.cost);
+    })){
+        return false;
+    }
+
+    // 先在临时张量上校验，全部成功后再替换，失败时原状态不变
+    YTensor<u_char,2> origin;
+    YTensor<float,2> cost;
+    YTensor<uint8_t,2> cost8;
+    YTensor<uint16_t,2> cost16;
+    YTensor<uint64_t,2> occupancy, blocked;
+    YTensor<JumpCell,2> jump;
+    if(!mapSection(base, sections[OriginMap], height, width, origin)
+        || !mapSection(base, sections[CostMap], height, width, cost)
+        || !mapSection(base, sections[CostMap8], height, width, cost8)
+        || !mapSection(base, sections[CostMap16], height, width, cost16)
+        || !mapSection(base, sections[OccupancyMap], height, words, occupancy)
+        || !mapSection(base, sections[BlockedMap], height, words, blocked)
+        || !mapSection(base, sections[JumpMap], height, width, jump)){
+        return false;
+    }
+    originMap = std::move(origin);
+    costMap = std::move(cost);
+    costMap8 = std::move(cost8);
+    costMap16 = std::move(cost16);
+    occupancyMap = std::move(occupancy);
+    blockedMap = std::move(blocked);
+    jumpMap = std::move(jump);
+
+    inflateMask.resize(maskCount);
+    std::transform(mask, mask + inflateMask.size(), inflateMask.begin(), [](const SnapshotMaskEntry& m){
+        return std::make_pair(std::make_pair(m.a, m.b), std::make_pair(m.bias, m.weight));
+    });
+    const float* table = reinterpret_cast<const float*>(base + sections[InflateTable].offset);
+    inflateTable.assign(table, table + tableCount);
+
+    mapping = header.mapping;
+    stride = header.stride;
+    speed = header.speed;
+    neighourCount = header.neighourCount;
+    costWeight = header.costWeight;
+    traditional = header.traditional;
+    jumpPointSearch = header.jumpPointSearch;
+    jumpMapDirty = !header.jumpMapValid;
+    heuristic = static_cast<HeuristicPolicy>(header.heuristic);
+    queuePolicy = static_cast<QueuePolicy>(header.queuePolicy);
+    bucketWidth = header.bucketWidth;
+    costQuantum = header.costQuantum;
+    uniformCost = header.uniformCost;
+    hardInflateRadius = header.hardInflateRadius;
+    costStorage = static_cast<CostStorage>(header.costStorage);
+    storageQuantum = header.storageQuantum;
+    quant8Step = header.quant8Step;
+    inflateMode = mode;
+    inflateRadius = header.inflateRadius;
+    snapshotMapping = std::move(fileMapping);
+    componentsDirty = true;// 连通分量不在快照里，prepare时重建
+    overlaidCost.clear();
+    for(size_t k=0; k<overlayCount; k++){
+        overlaidCost.emplace(overlay[k].index, overlay[k].cost);
+    }
+    clearFieldCache();
+
+    buildMotionTable();
+    context.resize(width, height);
+    batchContexts.clear();
+    return true;
+}
@@ -0,0 +1,198 @@
+#include "yDStarLite.hpp"
+#include<algorithm>
+#include<cmath>
+#include<execution>
+#include<iostream>
+#include<numeric>
+
+// 邻居方向(dy, dx)，与yAstar.cpp中一致
+static constexpr int neighour[8][2] = {{-1,0},{1,0},{0,-1},{0,1},{-1,-1},{-1,1},{1,-1},{1,1}};
+
+DStarLite::DStarLite(AStar& _astar): astar(_astar), openList(DNodeHeapPos{&nodes}){
+    width = height = 0;
+    goalIndex = startIndex = lastIndex = -1;
+    km = 0.f;
+    minCost = 1.f;
+    expanded = 0;
+}
+
+float DStarLite::heuristic(int a, int b) const {
+    int dx = std::abs(a%width - b%width), dy = std::abs(a/width - b/width);
+    return (std::max(dx, dy) + 0.414f * std::min(dx, dy)) * minCost;
+}
+
+DStarLite::Key DStarLite::calculateKey(int s) const {
+    const DNode& n = nodes.data[s];
+    float m = std::min(n.g, n.rhs);
+    return Key(m + heuristic(startIndex, s) + km, m);
+}
+
+void DStarLite::setGoal(std::pair<float, float> goal){
+    height = astar.costMap.shape(0);
+    width = astar.costMap.shape(1);
+    if(nodes.data == nullptr || nodes.shape(0) != height || nodes.shape(1) != width){
+        nodes = YTensor<DNode,2>(height, width);
+    }
+    nodes.fill(DNode{std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), -1});
+    openList = OpenList(DNodeHeapPos{&nodes});
+    minCost = std::reduce(std::execution::par_unseq, astar.costMap.data, astar.costMap.data + astar.costMap.size(), std::numeric_limits<float>::infinity(), [](float a, float b){ return std::min(a, b); });
+    int gx = goal.first/astar.mapping, gy = goal.second/astar.mapping;
+    goalIndex = gy*width + gx;
+    startIndex = goalIndex;
+    lastIndex = -1;
+    km = 0.f;
+    nodes.data[goalIndex].rhs = 0.f;
+    openList.push(goalIndex, calculateKey(goalIndex));
+}
+
+void DStarLite::recomputeRhs(int u){
+    if(u == goalIndex) return;
+    int x = u % width, y = u / width;
+    float best = std::numeric_limits<float>::infinity();
+    for(int i=0; i<8; i++){
+        int nx = x+neighour[i][1], ny = y+neighour[i][0];
+        if(nx<0 || nx>=width || ny<0 || ny>=height) continue;
+        int v = ny*width + nx;
+        float c = cellCost(v);
+        if(!(c < std::numeric_limits<float>::infinity())) continue;
+        best = std::min(best, c * (1.f + static_cast<int>(i/4)*0.414f) + nodes.data[v].g);
+    }
+    nodes.data[u].rhs = best;
+}
+
+void DStarLite::updateVertex(int u){
+    const DNode& n = nodes.data[u];
+    bool open = n.heapPos >= 0;
+    if(n.g != n.rhs){
+        openList.pushOrUpdate(u, calculateKey(u));
+    }else if(open){
+        openList.remove(u);
+    }
+}
+
+void DStarLite::computeShortestPath(){
+    expanded = 0;
+    while(!openList.empty()){
+        DNode& start = nodes.data[startIndex];
+        Key top = openList.top().key;
+        if(!(top < calculateKey(startIndex)) && start.rhs <= start.g) break;
+        int u = static_cast<int>(openList.top().index);
+        Key knew = calculateKey(u);
+        DNode& nu = nodes.data[u];
+        expanded++;
+        if(top < knew){
+            openList.update(u, knew);// key过期（起点移动过）
+            continue;
+        }
+        int x = u % width, y = u / width;
+        float cu = cellCost(u);// 前驱走进u的代价
+        if(nu.g > nu.rhs){
+            // 局部过一致，确定g值
+            nu.g = nu.rhs;
+            openList.remove(u);
+            if(!(cu < std::numeric_limits<float>::infinity())) continue;
+            for(int i=0; i<8; i++){
+                int nx = x+neighour[i][1], ny = y+neighour[i][0];
+                if(nx<0 || nx>=width || ny<0 || ny>=height) continue;
+                int s = ny*width + nx;
+                if(s != goalIndex){
+                    nodes.data[s].rhs = std::min(nodes.data[s].rhs, cu * (1.f + static_cast<int>(i/4)*0.414f) + nu.g);
+                }
+                updateVertex(s);
+            }
+        }else{
+            // 局部欠一致，g置为无穷后重算自身和前驱
+            float gold = nu.g;
+            nu.g = std::numeric_limits<float>::infinity();
+            for(int i=0; i<8; i++){
+                int nx = x+neighour[i][1], ny = y+neighour[i][0];
+                if(nx<0 || nx>=width || ny<0 || ny>=height) continue;
+                int s = ny*width + nx;
+                if(nodes.data[s].rhs == cu * (1.f + static_cast<int>(i/4)*0.414f) + gold){
+                    recomputeRhs(s);
+                }
+                updateVertex(s);
+            }
+            recomputeRhs(u);
+            updateVertex(u);
+        }
+    }
+}
+
+void DStarLite::notifyRegionChanged(const AStar::Region& region){
+    if(goalIndex < 0) return;
+    // 进入变化格子的边都变了，所以区域外扩一圈重算rhs
+    int x0 = std::max(0, region.x-1), y0 = std::max(0, region.y-1);
+    int x1 = std::min(width, region.x+region.w+1), y1 = std::min(height, region.y+region.h+1);
+    float lowest = minCost;
+    for(int y=y0; y<y1; y++){
+        for(int x=x0; x<x1; x++){
+            lowest = std::min(lowest, cellCost(y*width+x));
+        }
+    }
+    if(lastIndex < 0){
+        // 还没有规划过，搜索树只有终点，第一次replan会按当前的代价地图展开
+        minCost = lowest;
+        return;
+    }
+    if(lowest < minCost){
+        // 启发函数整体变小，开集里按旧比例算的key不再是下界，保持启发函数一致需要全部重算
+        minCost = lowest;
+        openList.rekey([this](size_t s){ return calculateKey(static_cast<int>(s)); });
+    }
+    for(int y=y0; y<y1; y++){
+        for(int x=x0; x<x1; x++){
+            int u = y*width + x;
+            recomputeRhs(u);
+            updateVertex(u);
+        }
+    }
+}
+
+std::vector<std::pair<float,float>> DStarLite::replan(std::pair<float, float> start){
+    std::vector<std::pair<float, float>> path;
+    if(goalIndex < 0) return path;
+    int sx = start.first/astar.mapping, sy = start.second/astar.mapping;
+    startIndex = sy*width + sx;
+    if(lastIndex < 0){
+        // 设置终点后的第一次规划，终点的key按真正的起点重新计算
+        openList.update(goalIndex, calculateKey(goalIndex));
+    }else{
+        km += heuristic(lastIndex, startIndex);
+    }
+    lastIndex = startIndex;
+    computeShortestPath();
+    // 结束时起点本身可能仍在开集中（key相等），它的代价以rhs为准
+    if(!(nodes.data[startIndex].rhs < std::numeric_limits<float>::infinity())){
+        std::cout<<"No path found!"<<std::endl;
+        return path;
+    }
+    // 沿 c(s, s') + g(s') 最小的方向走到终点
+    int s = startIndex;
+    size_t guard = static_cast<size_t>(width) * height;
+    path.emplace_back(sx*astar.mapping, sy*astar.mapping);
+    while(s != goalIndex && guard--){
+        int x = s % width, y = s / width;
+        int best = -1;
+        float bestCost = std::numeric_limits<float>::infinity();
+        for(int i=0; i<8; i++){
+            int nx = x+neighour[i][1], ny = y+neighour[i][0];
+            if(nx<0 || nx>=width || ny<0 || ny>=height) continue;
+            int v = ny*width + nx;
+            float c = cellCost(v) * (1.f + static_cast<int>(i/4)*0.414f) + nodes.data[v].g;
+            if(c < bestCost){
+                bestCost = c;
+                best = v;
+            }
+        }
+        if(!(bestCost < std::numeric_limits<float>::infinity())) break;
+        s = best;
+        path.emplace_back((s % width)*astar.mapping, (s / width)*astar.mapping);
+    }
+    // 下降中途断开或步数超过格子数（g值不一致时可能打转），不返回半截路径
+    if(s != goalIndex){
+        std::cout<<"No path found!"<<std::endl;
+        return std::vector<std::pair<float, float>>();
+    }
+    return path;
+}
@@ -0,0 +1,68 @@
+#ifndef YDSTARLITE_HPP
+#define YDSTARLITE_HPP
+
+#include <vector>
+#include "yAstar.hpp"
+
+// @brief D* Lite 增量重规划，共享AStar的代价地图。
+// 从终点反向搜索并在两次调用之间保留每个格子的g/rhs值，代价地图局部变化（比如AStar::updateRegion）后只修复受影响的部分，
+// 起点可以随着机器人前进而移动。代价按传统8邻居模型计算（进入格子的代价，斜行乘1.414），与setTraditional(true)时的search一致。
+class DStarLite{
+public:
+    // @param _astar 提供代价地图和映射比例，D* Lite对象不拥有它
+    explicit DStarLite(AStar& _astar);
+
+    // @brief 设置终点，清空之前保留的搜索树
+    // @param goal 终点（米）
+    void setGoal(std::pair<float, float> goal);
+
+    // @brief 通知代价地图的矩形区域发生了变化，只更新区域内及其一圈邻居的rhs值，真正的修复在下一次replan时进行
+    // 区域内出现比当前更小的代价时，启发函数的比例随之降低，开集的key整体重算（O(开集大小)）
+    // @param region 变化的矩形（像素），一般就是AStar::updateRegion的返回值
+    void notifyRegionChanged(const AStar::Region& region);
+
+    // @brief 从（可能已经移动过的）起点重新规划
+    // @param start 当前起点（米）
+    // @return 路径（返回空数组表示无解）
+    std::vector<std::pair<float, float>> replan(std::pair<float, float> start);
+
+    // 上一次replan中扩展的节点数
+    size_t lastExpanded() const { return expanded; }
+
+protected:
+    // 每个格子的搜索状态
+    struct DNode{
+        float g, rhs;
+        int heapPos;// 在开集堆中的位置，-1表示不在开集中
+    };
+    using Key = std::pair<float, float>;
+    struct DNodeHeapPos{
+        YTensor<DNode,2>* cpMap;
+        inline int& operator()(size_t index) const {
+            return cpMap->data[index].heapPos;
+        }
+    };
+    using OpenList = IndexedHeap<Key, DNodeHeapPos>;
+
+    inline float cellCost(int index) const { return astar.costMap.data[index]; }
+    // 一致的启发函数（octile距离乘最小代价）
+    float heuristic(int a, int b) const;
+    Key calculateKey(int s) const;
+    // 按当前的代价和邻居g值重新计算rhs
+    void recomputeRhs(int u);
+    void updateVertex(int u);
+    void computeShortestPath();
+
+    AStar& astar;
+    YTensor<DNode,2> nodes;
+    OpenList openList;
+    int width, height;
+    int goalIndex;   // 终点格子，-1表示未设置
+    int startIndex;  // 当前起点格子
+    int lastIndex;   // 上一次计算km时的起点，-1表示设置终点后还没有规划过
+    float km;        // 起点移动累计的key偏移
+    float minCost;   // 最小有限代价
+    size_t expanded; // 上一次replan扩展的节点数
+};
+
+#endif // YDSTARLITE_HPP
@@ -0,0 +1,275 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <algorithm>
+
+// @brief 带位置句柄的D叉堆（默认4叉），支持真正的decrease-key，不会压入重复元素。
+// @tparam Key 缓存在堆里的优先级（比如f值），比较时不需要再去查节点表
+// @tparam PosOf 函数对象，PosOf(index) 返回该元素在堆中位置的引用(int&)，-1表示不在堆中
+// @tparam Compare 比较Key的函数对象，Compare(a, b)为true表示a更优先
+// @tparam D 叉数，4叉时一个节点的孩子正好落在同一条缓存行里
+template <typename Key, typename PosOf, typename Compare = std::less<Key>, int D = 4>
+class IndexedHeap{
+public:
+    struct Entry{
+        Key key;      // 缓存的优先级
+        size_t index; // 节点索引
+    };
+
+    explicit IndexedHeap(PosOf _posOf = PosOf(), Compare _comp = Compare()): posOf(_posOf), comp(_comp) {}
+
+    inline bool empty() const { return heap.empty(); }
+    inline size_t size() const { return heap.size(); }
+    inline const Entry& top() const { return heap.front(); }
+    inline void reserve(size_t n){ heap.reserve(n); }
+    inline bool contains(size_t index) const { return posOf(index) >= 0; }
+
+    // 清空堆，同时把所有元素的位置句柄置为-1
+    void clear(){
+        for(auto& e : heap){
+            posOf(e.index) = -1;
+        }
+        heap.clear();
+    }
+
+    // 插入新元素，调用者保证index不在堆中
+    void push(size_t index, Key key){
+        heap.push_back(Entry{key, index});
+        posOf(index) = static_cast<int>(heap.size() - 1);
+        siftUp(heap.size() - 1);
+    }
+
+    // 降低已在堆中元素的Key
+    void decrease(size_t index, Key key){
+        int pos = posOf(index);
+        heap[pos].key = key;
+        siftUp(pos);
+    }
+
+    // 修改已在堆中元素的Key，可升可降
+    void update(size_t index, Key key){
+        int pos = posOf(index);
+        bool up = comp(key, heap[pos].key);
+        heap[pos].key = key;
+        if(up) siftUp(pos);
+        else siftDown(pos);
+    }
+
+    // 不在堆中则插入，否则更新Key
+    inline void pushOrUpdate(size_t index, Key key){
+        if(posOf(index) < 0) push(index, key);
+        else update(index, key);
+    }
+
+    // 弹出堆顶，返回其索引
+    size_t pop(){
+        size_t index = heap.front().index;
+        posOf(index) = -1;
+        if(heap.size() > 1){
+            heap.front() = heap.back();
+            heap.pop_back();
+            posOf(heap.front().index) = 0;
+            siftDown(0);
+        }else{
+            heap.pop_back();
+        }
+        return index;
+    }
+
+    // @brief 按keyOf(index)重新计算所有元素的Key并整体重建堆，O(n)
+    // 用于优先级函数整体改变的情况（比如ARA*降低启发权重）
+    template <typename KeyOf>
+    void rekey(KeyOf keyOf){
+        for(auto& e : heap){
+            e.key = keyOf(e.index);
+        }
+        for(size_t pos = heap.size() / D + 1; pos-- > 0;){
+            if(pos < heap.size()) siftDown(pos);
+        }
+    }
+
+    // 从堆中删除任意元素
+    void remove(size_t index){
+        int pos = posOf(index);
+        posOf(index) = -1;
+        if(pos == static_cast<int>(heap.size()) - 1){
+            heap.pop_back();
+            return;
+        }
+        Entry last = heap.back();
+        heap.pop_back();
+        bool up = comp(last.key, heap[pos].key);
+        heap[pos] = last;
+        posOf(last.index) = pos;
+        if(up) siftUp(pos);
+        else siftDown(pos);
+    }
+
+private:
+    void siftUp(size_t pos){
+        Entry e = heap[pos];
+        while(pos > 0){
+            size_t parent = (pos - 1) / D;
+            if(!comp(e.key, heap[parent].key)) break;
+            heap[pos] = heap[parent];
+            posOf(heap[pos].index) = static_cast<int>(pos);
+            pos = parent;
+        }
+        heap[pos] = e;
+        posOf(e.index) = static_cast<int>(pos);
+    }
+
+    void siftDown(size_t pos){
+        Entry e = heap[pos];
+        size_t n = heap.size();
+        while(true){
+            size_t first = pos * D + 1;
+            if(first >= n) break;
+            size_t last = std::min(first + D, n);
+            size_t best = first;
+            for(size_t c = first + 1; c < last; c++){
+                if(comp(heap[c].key, heap[best].key)) best = c;
+            }
+            if(!comp(heap[best].key, e.key)) break;
+            heap[pos] = heap[best];
+            posOf(heap[pos].index) = static_cast<int>(pos);
+            pos = best;
+        }
+        heap[pos] = e;
+        posOf(e.index) = static_cast<int>(pos);
+    }
+
+    std::vector<Entry> heap;
+    PosOf posOf;
+    Compare comp;
+};
+
+// @brief 单调桶队列（Dial算法），把Key按照桶宽量化成整数桶号，push/pop均摊O(1)。
+// 同一个桶内的元素不再区分先后（后进先出），所以弹出顺序相对精确的Key最多差一个桶宽。
+// 桶号小于当前游标的元素会被放进游标所在的桶（只会在启发函数不一致时出现；队列清空后第一次弹出前游标可以下降，见admit）。
+// 更新Key时不移动旧条目，而是压入新条目，旧条目在弹出时通过位置句柄识别为过期并跳过。
+// @tparam PosOf 函数对象，PosOf(index) 返回该元素当前所在桶号的引用(int&)，-1表示不在队列中
+template <typename PosOf>
+class BucketQueue{
+public:
+    explicit BucketQueue(float _bucketWidth, PosOf _posOf = PosOf(), size_t _capacity = 1024):
+        posOf(_posOf), invWidth(1.f / _bucketWidth), cursor(0), live(0)
+    {
+        size_t cap = 1;
+        while(cap < _capacity) cap <<= 1;
+        buckets.resize(cap);
+    }
+
+    inline bool empty() const { return live == 0; }
+    inline size_t size() const { return live; }
+    inline bool contains(size_t index) const { return posOf(index) >= 0; }
+
+    void clear(){
+        for(auto& bucket : buckets){
+            for(auto index : bucket) posOf(index) = -1;
+            bucket.clear();
+        }
+        cursor = 0;
+        live = 0;
+    }
+
+    // 插入新元素，调用者保证index不在队列中
+    void push(size_t index, float key){
+        int b = toBucket(key);
+        if(live == 0){
+            cursor = b;
+            fresh = true;
+            highest = b;
+        }else{
+            b = admit(b);
+        }
+        place(index, b);
+        live++;
+    }
+
+    // 修改已在队列中元素的Key，落在同一个桶时什么都不做
+    void update(size_t index, float key){
+        int b = admit(toBucket(key));
+        if(b == posOf(index)) return;
+        place(index, b);
+    }
+
+    inline void pushOrUpdate(size_t index, float key){
+        if(posOf(index) < 0) push(index, key);
+        else update(index, key);
+    }
+
+    // 弹出当前最小桶中的一个元素，返回其索引
+    size_t pop(){
+        size_t mask = buckets.size() - 1;
+        while(true){
+            auto& bucket = buckets[cursor & mask];
+            while(!bucket.empty()){
+                size_t index = bucket.back();
+                bucket.pop_back();
+                if(posOf(index) == cursor){
+                    posOf(index) = -1;
+                    live--;
+                    fresh = false;
+                    return index;
+                }
+                stale++;// 过期条目
+            }
+            cursor++;
+        }
+    }
+
+    size_t stale = 0;// 弹出时被跳过的过期条目数
+
+private:
+    inline int toBucket(float key) const {
+        return static_cast<int>(key * invWidth);
+    }
+
+    // 确定元素放进哪个桶。队列清空后游标定在第一个压入的元素上，同一次扩展里后压入的兄弟节点可能更小，
+    // 这时（还没有弹出过）游标跟着下降；之后比游标小的元素只会来自不一致的启发函数，放进游标所在的桶
+    int admit(int b){
+        if(b >= cursor){
+            if(fresh) highest = std::max(highest, b);
+            return b;
+        }
+        if(!fresh) return cursor;
+        if(static_cast<size_t>(highest - b) >= buckets.size()){
+            grow(static_cast<size_t>(highest - b) + 1);
+        }
+        cursor = b;
+        return b;
+    }
+
+    void place(size_t index, int b){
+        if(static_cast<size_t>(b - cursor) >= buckets.size()){
+            grow(static_cast<size_t>(b - cursor) + 1);
+        }
+        posOf(index) = b;
+        buckets[b & (buckets.size() - 1)].push_back(index);
+    }
+
+    // 扩容并重新分桶，顺带丢弃过期条目
+    void grow(size_t need){
+        size_t cap = buckets.size();
+        while(cap < need) cap <<= 1;
+        std::vector<std::vector<size_t>> old(cap);
+        old.swap(buckets);
+        for(auto& bucket : old){
+            for(auto index : bucket){
+                int b = posOf(index);
+                if(b >= cursor) buckets[b & (cap - 1)].push_back(index);
+            }
+        }
+    }
+
+    std::vector<std::vector<size_t>> buckets;
+    PosOf posOf;
+    float invWidth;
+    int cursor;  // 当前最小桶号
+    size_t live; // 有效元素个数
+    bool fresh = false;// 队列清空后还没有弹出过，游标可以下降
+    int highest = 0;   // fresh期间压入的最大桶号，游标下降时保证环形桶数组放得下
+};
@@ -3,7 +3,61 @@
 #include<cstddef>
 #include <utility>
 #include <iostream>
+#include <cstdlib>
+#include <memory>
+#include <functional>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// YTensor的数据内存：按64字节（缓存行/AVX-512）对齐分配，SIMD内核和搜索循环的行首都是对齐的。
+// hugePages为true时，不小于一个大页的分配按2MB对齐，并在Linux上用madvise申请透明大页，减少大地图的TLB缺失。
+struct YTensorMemory{
+    static constexpr size_t alignment = 64;
+    static constexpr size_t hugePageSize = size_t(2) << 20;
+    static inline bool hugePages = false;
+
+    static void* allocate(size_t bytes){
+        size_t align = alignment;
+        if(hugePages && bytes >= hugePageSize){
+            align = hugePageSize;
+        }
+        bytes = (bytes + align - 1) / align * align;// aligned_alloc要求大小是对齐的整数倍
+        void* p = std::aligned_alloc(align, bytes == 0 ? align : bytes);
+        if(p == nullptr){
+            throw std::bad_alloc();
+        }
+#ifdef MADV_HUGEPAGE
+        if(align == hugePageSize){
+            madvise(p, bytes, MADV_HUGEPAGE);// 只是建议，失败也不影响使用
+        }
+#endif
+        return p;
+    }
+
+    static void release(void* p){
+        std::free(p);
+    }
+
+    // 分配count个元素并默认初始化（与new T[count]相同，平凡类型不清零）
+    template <typename T>
+    static T* allocate(size_t count){
+        T* p = static_cast<T*>(allocate(count * sizeof(T)));
+        std::uninitialized_default_construct_n(p, count);
+        return p;
+    }
+
+    template <typename T>
+    static void release(T* p, size_t count){
+        if(p != nullptr){
+            std::destroy_n(p, count);
+            release(static_cast<void*>(p));
+        }
+    }
+};
 
+// 所有权规则：parent为true时拥有data，析构时释放；parent为false时为视图（operator[]的子张量或view()借用的外部内存），
+// 不释放data，调用者保证被引用的内存比视图活得久。dimensions总是由自己拥有。
 template <typename T=float, int dim=1>
 class YTensor
 {
@@ -15,12 +69,23 @@ public:
 
     ~YTensor();
     YTensor();
+    // 拷贝：拥有数据的张量深拷贝，视图的拷贝仍然是同一块内存的视图
+    YTensor(const YTensor& other);
+    // 移动：接管数据（或视图）和形状，不复制；被移动的张量只能再被赋值或析构
+    YTensor(YTensor&& other) noexcept;
     YTensor(std::vector<int> dims);
+    // @brief 借用外部内存的视图，不复制也不释放
+    // @param external 外部内存，按行优先存放
+    // @param dims 形状
+    static YTensor<T, dim> view(T* external, std::vector<int> dims);
+    // 交换两个张量的全部内容（包括所有权），不复制数据
+    void swap(YTensor& other);
     template <typename... Args>
     YTensor(Args...);
     YTensor(std::initializer_list<int> list);
     YTensor<T, dim - 1> operator[](int index);
     YTensor<T, dim> &operator=(const YTensor& other);
+    YTensor<T, dim> &operator=(YTensor&& other) noexcept;
     YTensor<T, dim> clone()const;
     YTensor<T, dim>& fill(T value);
     YTensor<T, dim>& setAll(std::function<T(T&)> func);
@@ -35,6 +100,7 @@ public:
     inline T &at(std::vector<int> &pos);
     inline T &at(int pos[]);
     inline T &atData(int dataPos);
+    inline const T &atData(int dataPos) const;
     template<typename... Args> inline size_t toIndex(Args... args);
     inline size_t toIndex(std::vector<int> &pos);
     inline size_t toIndex(int pos[]);
@@ -54,7 +120,11 @@ public:
     bool parent;
     ~YTensor();
     YTensor();
+    YTensor(const YTensor& other);
+    YTensor(YTensor&& other) noexcept;
     YTensor(int dim0);
+    YTensor<T, 1> &operator=(const YTensor& other);
+    YTensor<T, 1> &operator=(YTensor&& other) noexcept;
     T &operator[](int index);
     size_t size() const;
     template <typename _T> friend std::ostream &operator<<(std::ostream &os, const YTensor<_T,1> &tensor);
@@ -75,17 +145,14 @@ public:
 template <typename T, int dim>
 YTensor<T, dim>::~YTensor()
 {
-    if (parent)
+    if (parent && data != nullptr)
     {
-        if (data != nullptr)
-        {
-            delete[] data;
-            data = nullptr;
-        }
-        if (dimensions != nullptr){
-            delete[] dimensions;
-            dimensions = nullptr;
-        }
+        YTensorMemory::release(data, size());
+        data = nullptr;
+    }
+    if (dimensions != nullptr){
+        delete[] dimensions;
+        dimensions = nullptr;
     }
 }
 
@@ -98,13 +165,59 @@ YTensor<T, dim>::YTensor()
     parent = true;
 }
 
+template <typename T, int dim>
+YTensor<T, dim>::YTensor(const YTensor<T, dim> &other)
+{
+    dimensions = new int[dim];
+    std::copy(other.dimensions, other.dimensions + dim, dimensions);
+    parent = other.parent;
+    if (other.parent && other.data != nullptr)
+    {
+        data = YTensorMemory::allocate<T>(size());
+        std::copy(other.data, other.data + size(), data);
+    }
+    else
+    {
+        data = other.data;
+    }
+}
+
+template <typename T, int dim>
+YTensor<T, dim>::YTensor(YTensor<T, dim> &&other) noexcept
+{
+    data = other.data;
+    dimensions = other.dimensions;
+    parent = other.parent;
+    other.data = nullptr;
+    other.dimensions = nullptr;
+    other.parent = true;
+}
+
+template <typename T, int dim>
+YTensor<T, dim> YTensor<T, dim>::view(T* external, std::vector<int> dims)
+{
+    YTensor<T, dim> op;
+    std::copy(dims.begin(), dims.end(), op.dimensions);
+    op.data = external;
+    op.parent = false;
+    return op;
+}
+
+template <typename T, int dim>
+void YTensor<T, dim>::swap(YTensor<T, dim> &other)
+{
+    std::swap(data, other.data);
+    std::swap(dimensions, other.dimensions);
+    std::swap(parent, other.parent);
+}
+
 template <typename T, int dim>
 YTensor<T, dim>::YTensor(std::vector<int> dims)
 {
     dimensions = new int[dims.size()]; // std::fill
     std::copy(dims.begin(), dims.end(), dimensions);
     parent = true;
-    data = new T[size()];
+    data = YTensorMemory::allocate<T>(size());
 }
 
 template <typename T, int dim>
@@ -116,7 +229,7 @@ YTensor<T, dim>::YTensor(Args... args)
     // auto seq = std::make_index_sequence<sizeof...(args)>();
     int a = 0;
     ((dimensions[a++] = args), ...);
-    data = new T[size()];
+    data = YTensorMemory::allocate<T>(size());
     parent = true;
 }
 
@@ -125,7 +238,7 @@ YTensor<T, dim>::YTensor(std::initializer_list<int> list)
 {
     dimensions = new int[list.size()];
     std::copy(list.begin(), list.end(), dimensions);
-    data = new T[size()];
+    data = YTensorMemory::allocate<T>(size());
     parent = true;
 }
 
@@ -134,8 +247,7 @@ YTensor<T, dim - 1> YTensor<T, dim>::operator[](int index)
 {
     index = (index % dimensions[0] + dimensions[0]) % dimensions[0];
     YTensor<T, dim - 1> op;
-    delete[] op.dimensions;
-    op.dimensions = this->dimensions + 1;
+    std::copy(this->dimensions + 1, this->dimensions + dim, op.dimensions);
     op.data = this->data + op.size() * index;
     op.parent = false;
     return op;
@@ -148,20 +260,45 @@ YTensor<T, dim> &YTensor<T, dim>::operator=(const YTensor<T, dim> &other)
     {
         throw std::invalid_argument("YTensor shape size does not match");
     }
-    if (parent)
+    if (this == &other)
     {
-        if (data != nullptr)
-        {
-            delete[] data;
-        }
+        return *this;
+    }
+    // 赋值总是深拷贝，视图被赋值后变为拥有数据的张量，不会写入借用的内存
+    // 已经拥有同样大小的数据时直接复用，不重新分配
+    if (dimensions == nullptr)
+    {
+        dimensions = new int[dim];
+        std::fill(dimensions, dimensions + dim, 0);
+    }
+    bool reuse = parent && data != nullptr && other.data != nullptr && size() == other.size();
+    if (!reuse && parent && data != nullptr)
+    {
+        YTensorMemory::release(data, size());
     }
     std::copy(other.dimensions, other.dimensions + dim, dimensions);
     parent = true;
-    this->data = new T[size()];
+    if (other.data == nullptr)
+    {
+        this->data = nullptr;
+        return *this;
+    }
+    if (!reuse)
+    {
+        this->data = YTensorMemory::allocate<T>(size());
+    }
     std::copy(other.data, other.data + other.size(), data);
     return *this;
 }
 
+template <typename T, int dim>
+YTensor<T, dim> &YTensor<T, dim>::operator=(YTensor<T, dim> &&other) noexcept
+{
+    // 交换后旧数据随other析构释放
+    swap(other);
+    return *this;
+}
+
 template<typename T,int dim>
 YTensor<T, dim> YTensor<T, dim>::clone()const{
     YTensor<T,dim> op(this->shape());
@@ -189,7 +326,6 @@ YTensor<T, dim> YTensor<T, dim>::operator*(const YTensor &other)
         throw std::invalid_argument("Dimensions must match");
     }
     YTensor<T, dim> op(this->shape());
-    op.parent = false;
     std::transform(std::execution::par_unseq, this->data, this->data + size(), other.data, op.data, std::multiplies<T>());
     return op;
 }
@@ -267,6 +403,11 @@ T& YTensor<T,dim>::atData(int atData){
     return *(data+atData);
 }
 
+template<typename T, int dim>
+const T& YTensor<T,dim>::atData(int atData) const {
+    return *(data+atData);
+}
+
 template <typename T, int dim>
 size_t YTensor<T, dim>::dimSize(int atDim) const
 {
@@ -399,17 +540,14 @@ size_t YTensor<T, 1>::size() const
 template <typename T>
 YTensor<T, 1>::~YTensor()
 {
-    if (parent)
+    if (parent && data != nullptr)
     {
-        if (data != nullptr)
-        {
-            delete[] data;
-            data = nullptr;
-        }
-        if (dimensions != nullptr){
-            delete[] dimensions;
-            dimensions = nullptr;
-        }
+        YTensorMemory::release(data, size());
+        data = nullptr;
+    }
+    if (dimensions != nullptr){
+        delete[] dimensions;
+        dimensions = nullptr;
     }
 }
 
@@ -422,15 +560,72 @@ YTensor<T, 1>::YTensor()
     parent = true;
 }
 
+template <typename T>
+YTensor<T, 1>::YTensor(const YTensor<T, 1> &other)
+{
+    dimensions = new int[1];
+    dimensions[0] = other.dimensions[0];
+    parent = other.parent;
+    if (other.parent && other.data != nullptr)
+    {
+        data = YTensorMemory::allocate<T>(dimensions[0]);
+        std::copy(other.data, other.data + dimensions[0], data);
+    }
+    else
+    {
+        data = other.data;
+    }
+}
+
+template <typename T>
+YTensor<T, 1>::YTensor(YTensor<T, 1> &&other) noexcept
+{
+    data = other.data;
+    dimensions = other.dimensions;
+    parent = other.parent;
+    other.data = nullptr;
+    other.dimensions = nullptr;
+    other.parent = true;
+}
+
 template <typename T>
 YTensor<T, 1>::YTensor(int dim0)
 {
     dimensions = new int[1];
     dimensions[0] = dim0;
-    data = new T[dim0];
+    data = YTensorMemory::allocate<T>(dim0);
     parent = true;
 }
 
+template <typename T>
+YTensor<T, 1> &YTensor<T, 1>::operator=(const YTensor<T, 1> &other)
+{
+    if (this != &other)
+    {
+        YTensor<T, 1> copy(other.dimensions[0]);
+        if (other.data != nullptr)
+        {
+            std::copy(other.data, other.data + other.dimensions[0], copy.data);
+        }
+        else
+        {
+            YTensorMemory::release(copy.data, copy.dimensions[0]);
+            copy.data = nullptr;
+        }
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+template <typename T>
+YTensor<T, 1> &YTensor<T, 1>::operator=(YTensor<T, 1> &&other) noexcept
+{
+    std::swap(data, other.data);
+    std::swap(dimensions, other.dimensions);
+    std::swap(parent, other.parent);
+    return *this;
+}
+
 template <typename T>
 std::ostream &operator<<(std::ostream &out, const YTensor<T, 1> &tensor)
 {